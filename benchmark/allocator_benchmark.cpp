@@ -0,0 +1,177 @@
+#include "corpus_generator.h"
+#include "memory_resources.h"
+#include "search_server.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// все выделения процесса через operator new, чтобы сравнивать и с обычным аллокатором
+namespace {
+
+std::atomic<size_t> global_allocation_count{0};
+
+// все перегрузки operator delete освобождают память здесь: встроенный в вызывающий код
+// std::free GCC принимает за освобождение памяти от new не той функцией (-Wmismatched-new-delete)
+[[gnu::noinline]] void FreeAllocation(void* p) noexcept {
+    std::free(p);
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    global_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+// через эту перегрузку выделяет std::pmr::new_delete_resource()
+void* operator new(size_t size, std::align_val_t alignment) {
+    global_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    const size_t align = std::max(static_cast<size_t>(alignment), sizeof(void*));
+    void* p = nullptr;
+    if (posix_memalign(&p, align, size == 0 ? 1 : size) == 0) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    FreeAllocation(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    FreeAllocation(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    FreeAllocation(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    FreeAllocation(p);
+}
+
+namespace {
+
+const size_t DOCUMENT_COUNT = 10000;
+
+enum ResourceKind {
+    DEFAULT_RESOURCE,
+    POOL_RESOURCE,
+    MONOTONIC_RESOURCE,
+};
+
+const Corpus& GetCorpus() {
+    static const Corpus corpus = [] {
+        CorpusOptions options;
+        options.document_count = DOCUMENT_COUNT;
+        return GenerateCorpus(options);
+    }();
+    return corpus;
+}
+
+// ресурс для индекса; сервер, созданный поверх, должен быть уничтожен раньше
+std::unique_ptr<std::pmr::memory_resource> MakeResource(int kind) {
+    switch (kind) {
+    case POOL_RESOURCE:
+        return std::make_unique<std::pmr::unsynchronized_pool_resource>();
+    case MONOTONIC_RESOURCE:
+        return std::make_unique<std::pmr::monotonic_buffer_resource>();
+    default:
+        return nullptr;
+    }
+}
+
+size_t GetResidentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    statm >> total_pages >> resident_pages;
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+} // namespace
+
+// построение индекса: range(0) - ресурс индекса
+static void BM_BuildIndex(benchmark::State& state) {
+    const Corpus& corpus = GetCorpus();
+    size_t allocations = 0;
+    size_t index_bytes = 0;
+    size_t resident_bytes = 0;
+    for (auto _ : state) {
+        auto resource = MakeResource(state.range(0));
+        CountingMemoryResource index_memory(resource ? resource.get() : std::pmr::get_default_resource());
+        const size_t allocations_before = global_allocation_count.load();
+        SearchServer search_server = BuildSearchServer(corpus, &index_memory);
+        allocations += global_allocation_count.load() - allocations_before;
+        index_bytes = index_memory.GetBytesInUse();
+        resident_bytes = GetResidentBytes();
+    }
+    const size_t documents = state.iterations() * corpus.documents.size();
+    state.counters["allocs_per_op"] = static_cast<double>(allocations) / documents;
+    state.counters["index_bytes_in_use"] = static_cast<double>(index_bytes);
+    state.counters["rss_bytes"] = static_cast<double>(resident_bytes);
+    state.SetItemsProcessed(documents);
+}
+BENCHMARK(BM_BuildIndex)->Arg(DEFAULT_RESOURCE)->Arg(POOL_RESOURCE)->Arg(MONOTONIC_RESOURCE)
+    ->Unit(benchmark::kMillisecond);
+
+// долгая работа с удалением и повторным добавлением документов: range(0) - ресурс индекса;
+// rss_bytes против index_bytes_in_use показывает фрагментацию
+static void BM_IndexChurn(benchmark::State& state) {
+    const Corpus& corpus = GetCorpus();
+    auto resource = MakeResource(state.range(0));
+    CountingMemoryResource index_memory(resource ? resource.get() : std::pmr::get_default_resource());
+    SearchServer search_server = BuildSearchServer(corpus, &index_memory);
+
+    size_t next_id = corpus.documents.size();
+    size_t allocations = 0;
+    for (auto _ : state) {
+        const size_t allocations_before = global_allocation_count.load();
+        const int removed_id = static_cast<int>(next_id - corpus.documents.size());
+        search_server.RemoveDocument(removed_id);
+        const size_t source = next_id % corpus.documents.size();
+        search_server.AddDocument(static_cast<int>(next_id), corpus.documents[source],
+                                  corpus.statuses[source], corpus.ratings[source]);
+        ++next_id;
+        allocations += global_allocation_count.load() - allocations_before;
+    }
+    state.counters["allocs_per_op"] = static_cast<double>(allocations) / state.iterations();
+    state.counters["index_bytes_in_use"] = static_cast<double>(index_memory.GetBytesInUse());
+    state.counters["rss_bytes"] = static_cast<double>(GetResidentBytes());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IndexChurn)->Arg(DEFAULT_RESOURCE)->Arg(POOL_RESOURCE);
+
+// выделения на запрос: временные структуры поиска берутся из QueryArena
+static void BM_QueryAllocations(benchmark::State& state) {
+    static const SearchServer search_server = BuildSearchServer(GetCorpus());
+    CorpusOptions options;
+    options.document_count = DOCUMENT_COUNT;
+    const std::vector<std::string> queries = GenerateQueries(options, 1000, 4, 0.15, 7);
+
+    size_t i = 0;
+    size_t allocations = 0;
+    for (auto _ : state) {
+        const size_t allocations_before = global_allocation_count.load();
+        benchmark::DoNotOptimize(search_server.FindTopDocuments(queries[i++ % queries.size()]));
+        allocations += global_allocation_count.load() - allocations_before;
+    }
+    state.counters["allocs_per_op"] = static_cast<double>(allocations) / state.iterations();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_QueryAllocations);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,121 @@
+#include "corpus_generator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const std::string_view CONSONANTS = "bcdfghklmnprstvz";
+const std::string_view VOWELS = "aeiou";
+
+} // namespace
+
+std::string MakeWord(size_t index) {
+    // слово из слогов "согласная + гласная", номер записан в системе счисления по числу слогов
+    const size_t syllable_count = CONSONANTS.size() * VOWELS.size();
+    std::string word;
+    do {
+        const size_t syllable = index % syllable_count;
+        word += CONSONANTS[syllable / VOWELS.size()];
+        word += VOWELS[syllable % VOWELS.size()];
+        index /= syllable_count;
+    } while (index > 0);
+    return word;
+}
+
+ZipfianWordGenerator::ZipfianWordGenerator(size_t vocabulary_size, double exponent) {
+    vocabulary_.reserve(vocabulary_size);
+    cumulative_weights_.reserve(vocabulary_size);
+    double total = 0.0;
+    for (size_t rank = 1; rank <= vocabulary_size; ++rank) {
+        vocabulary_.push_back(MakeWord(rank - 1));
+        total += 1.0 / std::pow(static_cast<double>(rank), exponent);
+        cumulative_weights_.push_back(total);
+    }
+}
+
+std::string_view ZipfianWordGenerator::Next(std::mt19937& generator) const {
+    std::uniform_real_distribution<double> distribution(0.0, cumulative_weights_.back());
+    const auto it = std::upper_bound(cumulative_weights_.begin(), cumulative_weights_.end(), distribution(generator));
+    const size_t rank = std::min<size_t>(it - cumulative_weights_.begin(), vocabulary_.size() - 1);
+    return vocabulary_[rank];
+}
+
+Corpus GenerateCorpus(const CorpusOptions& options) {
+    std::mt19937 generator(options.seed);
+    const ZipfianWordGenerator words(options.vocabulary_size, options.zipf_exponent);
+
+    Corpus corpus;
+    // стоп-слова берутся за пределами словаря, чтобы не пересекаться с ним
+    for (size_t i = 0; i < options.stop_word_count; ++i) {
+        corpus.stop_words.push_back(MakeWord(options.vocabulary_size + i));
+    }
+
+    std::bernoulli_distribution is_stop_word(options.stop_word_ratio);
+    std::uniform_int_distribution<size_t> stop_word_index(0, std::max<size_t>(options.stop_word_count, 1) - 1);
+    std::uniform_int_distribution<int> status(0, 9);
+    std::uniform_int_distribution<int> rating(-10, 10);
+    std::uniform_int_distribution<int> rating_count(1, 5);
+
+    corpus.documents.reserve(options.document_count);
+    for (size_t id = 0; id < options.document_count; ++id) {
+        std::string text;
+        for (size_t i = 0; i < options.words_per_document; ++i) {
+            if (!text.empty()) {
+                text += ' ';
+            }
+            if (!corpus.stop_words.empty() && is_stop_word(generator)) {
+                text += corpus.stop_words[stop_word_index(generator)];
+            } else {
+                text += words.Next(generator);
+            }
+        }
+        corpus.documents.push_back(std::move(text));
+
+        // большинство документов актуальны, остальные распределены по статусам
+        const int status_value = status(generator);
+        corpus.statuses.push_back(status_value < 7 ? DocumentStatus::ACTUAL
+                                  : static_cast<DocumentStatus>(status_value - 6));
+
+        std::vector<int> document_ratings(rating_count(generator));
+        for (int& value : document_ratings) {
+            value = rating(generator);
+        }
+        corpus.ratings.push_back(std::move(document_ratings));
+    }
+    return corpus;
+}
+
+std::vector<std::string> GenerateQueries(const CorpusOptions& options, size_t query_count,
+                                         size_t words_per_query, double minus_word_ratio,
+                                         uint32_t seed) {
+    std::mt19937 generator(seed);
+    const ZipfianWordGenerator words(options.vocabulary_size, options.zipf_exponent);
+    std::bernoulli_distribution is_minus_word(minus_word_ratio);
+
+    std::vector<std::string> queries;
+    queries.reserve(query_count);
+    for (size_t q = 0; q < query_count; ++q) {
+        std::string query;
+        for (size_t i = 0; i < words_per_query; ++i) {
+            if (!query.empty()) {
+                query += ' ';
+            }
+            if (is_minus_word(generator)) {
+                query += '-';
+            }
+            query += words.Next(generator);
+        }
+        queries.push_back(std::move(query));
+    }
+    return queries;
+}
+
+SearchServer BuildSearchServer(const Corpus& corpus, std::pmr::memory_resource* index_resource) {
+    SearchServer search_server(corpus.stop_words, index_resource);
+    for (size_t id = 0; id < corpus.documents.size(); ++id) {
+        search_server.AddDocument(static_cast<int>(id), corpus.documents[id],
+                                  corpus.statuses[id], corpus.ratings[id]);
+    }
+    return search_server;
+}
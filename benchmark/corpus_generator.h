@@ -0,0 +1,63 @@
+#pragma once
+
+#include "search_server.h"
+#include "document.h"
+
+#include <cstdint>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct CorpusOptions {
+    size_t document_count = 10000;
+    size_t words_per_document = 40;
+    size_t vocabulary_size = 20000;
+    double zipf_exponent = 1.0;
+    // доля слов документа, заменяемых стоп-словами
+    double stop_word_ratio = 0.2;
+    size_t stop_word_count = 30;
+    uint32_t seed = 42;
+};
+
+struct Corpus {
+    std::vector<std::string> stop_words;
+    std::vector<std::string> documents;
+    std::vector<DocumentStatus> statuses;
+    std::vector<std::vector<int>> ratings;
+};
+
+/**
+ * Выдаёт слова словаря с частотами по закону Ципфа:
+ * вероятность слова ранга k пропорциональна 1 / k^exponent.
+ * При одинаковом seed последовательность слов одна и та же.
+ */
+class ZipfianWordGenerator {
+public:
+    ZipfianWordGenerator(size_t vocabulary_size, double exponent);
+
+    std::string_view Next(std::mt19937& generator) const;
+
+    const std::vector<std::string>& GetVocabulary() const {
+        return vocabulary_;
+    }
+
+private:
+    std::vector<std::string> vocabulary_;
+    std::vector<double> cumulative_weights_;
+};
+
+// детерминированное псевдослово с номером index
+std::string MakeWord(size_t index);
+
+Corpus GenerateCorpus(const CorpusOptions& options);
+
+// запросы из слов того же распределения; часть слов - минус-слова
+std::vector<std::string> GenerateQueries(const CorpusOptions& options, size_t query_count,
+                                         size_t words_per_query, double minus_word_ratio,
+                                         uint32_t seed);
+
+// узлы индекса берутся из index_resource (он должен пережить сервер)
+SearchServer BuildSearchServer(const Corpus& corpus,
+                               std::pmr::memory_resource* index_resource = std::pmr::get_default_resource());
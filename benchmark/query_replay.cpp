@@ -0,0 +1,499 @@
+#include "corpus_generator.h"
+
+#include "process_queries.h"
+#include "request_queue.h"
+#include "search_server.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <execution>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Воспроизводит журнал запросов на SearchServer и измеряет пропускную
+ * способность и задержки.
+ *
+ * search_server_query_replay [--key=value ...]
+ *   --corpus=файл       строки "текст[\tстатус[\tрейтинги через пробел]]", id - номер строки;
+ *                       без него корпус генерируется (--documents, по умолчанию 10000)
+ *   --stop-words="..."  стоп-слова для корпуса из файла
+ *   --log=файл          строки "запрос[\tфильтр[\tвремя в мс]]", фильтр - ACTUAL, IRRELEVANT,
+ *                       BANNED, REMOVED, rating>=N или пусто; без него журнал генерируется (--queries)
+ *   --target=seq|par|process|queue   путь поиска: FindTopDocuments(seq/par), ProcessQueries
+ *                       пачками по --batch запросов (без фильтров журнала), RequestQueue
+ *                       (своя очередь у каждого клиента)
+ *   --mode=open|closed  open - запросы начинаются по расписанию (--qps или время из журнала
+ *                       с --use-timestamps и --speed), closed - --clients клиентов шлют
+ *                       следующий запрос сразу после ответа
+ *   --clients=N         число клиентов (в open - потоков, исполняющих расписание)
+ *   --requests=N        сколько запросов выполнить (журнал повторяется по кругу)
+ *
+ * В открытом режиме задержка считается от назначенного времени начала запроса,
+ * поэтому очередь к перегруженному серверу входит в неё (нет скоординированного
+ * пропуска). В закрытом режиме p99 исправляется как в HdrHistogram: за медленным
+ * ответом досчитываются запросы, которые клиент не отправил, пока ждал.
+ * Запросы, отклонённые сервером (например, "--cat"), считаются в errors
+ * (для process - вся пачка) и не входят в QPS и задержки.
+ */
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct ReplayQuery {
+    string text;
+    optional<DocumentStatus> status;
+    optional<int> min_rating;
+    // от начала журнала
+    optional<chrono::nanoseconds> timestamp;
+};
+
+struct ReplayOptions {
+    string target = "seq";
+    string mode = "closed";
+    size_t clients = 1;
+    double qps = 100;
+    bool use_timestamps = false;
+    double speed = 1.0;
+    size_t requests = 0;
+    size_t batch = 16;
+};
+
+map<string, string> ParseArguments(int argc, char* argv[]) {
+    map<string, string> arguments;
+    for (int i = 1; i < argc; ++i) {
+        const string_view argument = argv[i];
+        if (argument.substr(0, 2) != "--"sv) {
+            throw invalid_argument("Unexpected argument: "s + string(argument));
+        }
+        const size_t equals = argument.find('=');
+        if (equals == string_view::npos) {
+            arguments[string(argument.substr(2))] = "1"s;
+        } else {
+            arguments[string(argument.substr(2, equals - 2))] = string(argument.substr(equals + 1));
+        }
+    }
+    return arguments;
+}
+
+vector<string_view> SplitFields(string_view line) {
+    vector<string_view> fields;
+    while (true) {
+        const size_t tab = line.find('\t');
+        fields.push_back(line.substr(0, tab));
+        if (tab == string_view::npos) {
+            return fields;
+        }
+        line.remove_prefix(tab + 1);
+    }
+}
+
+DocumentStatus ParseStatus(string_view text) {
+    static const map<string_view, DocumentStatus> statuses = {
+        {"ACTUAL"sv, DocumentStatus::ACTUAL},
+        {"IRRELEVANT"sv, DocumentStatus::IRRELEVANT},
+        {"BANNED"sv, DocumentStatus::BANNED},
+        {"REMOVED"sv, DocumentStatus::REMOVED},
+    };
+    const auto it = statuses.find(text);
+    if (it == statuses.end()) {
+        throw invalid_argument("Unknown status: "s + string(text));
+    }
+    return it->second;
+}
+
+Corpus ReadCorpus(const string& path, const string& stop_words) {
+    ifstream input(path);
+    if (!input) {
+        throw invalid_argument("Cannot open corpus "s + path);
+    }
+    Corpus corpus;
+    istringstream stop_words_input(stop_words);
+    for (string word; stop_words_input >> word;) {
+        corpus.stop_words.push_back(word);
+    }
+    string line;
+    while (getline(input, line)) {
+        const vector<string_view> fields = SplitFields(line);
+        corpus.documents.emplace_back(fields[0]);
+        corpus.statuses.push_back(fields.size() > 1 && !fields[1].empty() ? ParseStatus(fields[1]) : DocumentStatus::ACTUAL);
+        vector<int> ratings;
+        if (fields.size() > 2) {
+            istringstream ratings_input{string(fields[2])};
+            for (int rating; ratings_input >> rating;) {
+                ratings.push_back(rating);
+            }
+        }
+        corpus.ratings.push_back(move(ratings));
+    }
+    return corpus;
+}
+
+vector<ReplayQuery> ReadQueryLog(const string& path) {
+    ifstream input(path);
+    if (!input) {
+        throw invalid_argument("Cannot open query log "s + path);
+    }
+    vector<ReplayQuery> queries;
+    string line;
+    while (getline(input, line)) {
+        const vector<string_view> fields = SplitFields(line);
+        ReplayQuery query;
+        query.text = string(fields[0]);
+        if (fields.size() > 1 && !fields[1].empty()) {
+            if (fields[1].substr(0, 8) == "rating>="sv) {
+                query.min_rating = stoi(string(fields[1].substr(8)));
+            } else {
+                query.status = ParseStatus(fields[1]);
+            }
+        }
+        if (fields.size() > 2 && !fields[2].empty()) {
+            query.timestamp = chrono::duration_cast<chrono::nanoseconds>(
+                chrono::duration<double, milli>(stod(string(fields[2]))));
+        }
+        queries.push_back(move(query));
+    }
+    if (queries.empty()) {
+        throw invalid_argument("Empty query log "s + path);
+    }
+    return queries;
+}
+
+// смесь коротких, длинных, с минус-словами и с фильтрами
+vector<ReplayQuery> GenerateQueryLog(const CorpusOptions& options, size_t query_count) {
+    const vector<string> short_queries = GenerateQueries(options, query_count, 1, 0.0, 11);
+    const vector<string> long_queries = GenerateQueries(options, query_count, 8, 0.1, 12);
+    const vector<string> minus_queries = GenerateQueries(options, query_count, 4, 0.5, 13);
+    const vector<string> plain_queries = GenerateQueries(options, query_count, 3, 0.15, 14);
+    vector<ReplayQuery> queries(query_count);
+    for (size_t i = 0; i < query_count; ++i) {
+        switch (i % 8) {
+        case 0:
+        case 1:
+            queries[i].text = short_queries[i];
+            break;
+        case 2:
+            queries[i].text = long_queries[i];
+            break;
+        case 3:
+            queries[i].text = minus_queries[i];
+            break;
+        case 4:
+            queries[i].text = plain_queries[i];
+            queries[i].status = DocumentStatus::BANNED;
+            break;
+        case 5:
+            queries[i].text = plain_queries[i];
+            queries[i].min_rating = 5;
+            break;
+        default:
+            queries[i].text = plain_queries[i];
+        }
+    }
+    return queries;
+}
+
+// выполняет запросы одного клиента; для process - пачку, начинающуюся с query
+class QueryRunner {
+public:
+    QueryRunner(const SearchServer& search_server, const ReplayOptions& options, const vector<ReplayQuery>& log)
+        : search_server_(search_server)
+        , options_(options)
+        , log_(log)
+        , request_queue_(search_server) {
+    }
+
+    // число выполненных запросов
+    size_t Run(size_t index) {
+        const ReplayQuery& query = log_[index % log_.size()];
+        if (options_.target == "process"sv) {
+            batch_.clear();
+            for (size_t i = 0; i < options_.batch; ++i) {
+                batch_.push_back(log_[(index + i) % log_.size()].text);
+            }
+            for (const vector<Document>& documents : ProcessQueries(search_server_, batch_)) {
+                result_count_ += documents.size();
+            }
+            return batch_.size();
+        }
+        if (options_.target == "queue"sv) {
+            if (query.min_rating) {
+                result_count_ += request_queue_.AddFindRequest(query.text, MakeRatingFilter(*query.min_rating)).size();
+            } else {
+                result_count_ += request_queue_.AddFindRequest(query.text, query.status.value_or(DocumentStatus::ACTUAL)).size();
+            }
+            return 1;
+        }
+        if (options_.target == "par"sv) {
+            result_count_ += Find(execution::par, query);
+        } else {
+            result_count_ += Find(execution::seq, query);
+        }
+        return 1;
+    }
+
+    size_t GetResultCount() const {
+        return result_count_;
+    }
+
+private:
+    static function<bool(int, DocumentStatus, int)> MakeRatingFilter(int min_rating) {
+        return [min_rating](int, DocumentStatus status, int rating) {
+            return status == DocumentStatus::ACTUAL && rating >= min_rating;
+        };
+    }
+
+    template <typename ExecutionPolicy>
+    size_t Find(const ExecutionPolicy& policy, const ReplayQuery& query) const {
+        if (query.min_rating) {
+            return search_server_.FindTopDocuments(policy, query.text, MakeRatingFilter(*query.min_rating)).size();
+        }
+        return search_server_.FindTopDocuments(policy, query.text, query.status.value_or(DocumentStatus::ACTUAL)).size();
+    }
+
+    const SearchServer& search_server_;
+    const ReplayOptions& options_;
+    const vector<ReplayQuery>& log_;
+    RequestQueue request_queue_;
+    vector<string> batch_;
+    size_t result_count_ = 0;
+};
+
+struct ClientResult {
+    // время выполнения запроса
+    vector<uint64_t> service_times;
+    // в открытом режиме - от назначенного времени начала
+    vector<uint64_t> response_times;
+    size_t query_count = 0;
+    size_t result_count = 0;
+    // запросы, на которых поиск бросил исключение (некорректный запрос журнала);
+    // они не входят в query_count и задержки
+    size_t error_count = 0;
+    string first_error;
+};
+
+// расписание открытого режима: назначенное время начала запроса index
+class Schedule {
+public:
+    Schedule(const ReplayOptions& options, const vector<ReplayQuery>& log)
+        : options_(options)
+        , log_(log) {
+        if (options_.use_timestamps) {
+            for (const ReplayQuery& query : log_) {
+                if (!query.timestamp) {
+                    throw invalid_argument("--use-timestamps needs a timestamp in every log line");
+                }
+            }
+            // при повторе журнала по кругу следующий проход сдвигается на длительность журнала
+            period_ = *log_.back().timestamp - *log_.front().timestamp + chrono::milliseconds(1);
+        }
+    }
+
+    chrono::nanoseconds GetOffset(size_t index) const {
+        if (!options_.use_timestamps) {
+            return chrono::nanoseconds(static_cast<int64_t>(index * 1e9 / options_.qps));
+        }
+        const ReplayQuery& query = log_[index % log_.size()];
+        const auto offset = *query.timestamp - *log_.front().timestamp + period_ * (index / log_.size());
+        return chrono::nanoseconds(static_cast<int64_t>(offset.count() / options_.speed));
+    }
+
+private:
+    const ReplayOptions& options_;
+    const vector<ReplayQuery>& log_;
+    chrono::nanoseconds period_{0};
+};
+
+uint64_t ToNanoseconds(Clock::duration duration) {
+    return static_cast<uint64_t>(max<int64_t>(0, chrono::duration_cast<chrono::nanoseconds>(duration).count()));
+}
+
+vector<ClientResult> Replay(const SearchServer& search_server, const ReplayOptions& options,
+                            const vector<ReplayQuery>& log) {
+    const Schedule schedule(options, log);
+    const size_t step = options.target == "process"sv ? options.batch : 1;
+    atomic<size_t> next_index{0};
+    vector<ClientResult> results(options.clients);
+    vector<thread> clients;
+    const Clock::time_point start = Clock::now();
+
+    for (size_t client = 0; client < options.clients; ++client) {
+        clients.emplace_back([&, client] {
+            QueryRunner runner(search_server, options, log);
+            ClientResult& result = results[client];
+            while (true) {
+                const size_t index = next_index.fetch_add(step);
+                if (index >= options.requests) {
+                    break;
+                }
+                Clock::time_point intended_start = Clock::now();
+                if (options.mode == "open"sv) {
+                    intended_start = start + schedule.GetOffset(index);
+                    this_thread::sleep_until(intended_start);
+                }
+                const Clock::time_point actual_start = Clock::now();
+                try {
+                    result.query_count += runner.Run(index);
+                } catch (const exception& error) {
+                    if (result.error_count == 0) {
+                        result.first_error = error.what();
+                    }
+                    result.error_count += step;
+                    continue;
+                }
+                const Clock::time_point finish = Clock::now();
+                result.service_times.push_back(ToNanoseconds(finish - actual_start));
+                result.response_times.push_back(ToNanoseconds(finish - intended_start));
+            }
+            result.result_count = runner.GetResultCount();
+        });
+    }
+    for (thread& client : clients) {
+        client.join();
+    }
+    return results;
+}
+
+// как recordValueWithExpectedInterval в HdrHistogram: ответ дольше
+// expected_interval означает, что за это время клиент не отправил запросы, которые
+// ждали бы value - expected_interval, value - 2 * expected_interval, ...
+void RecordCorrected(HistogramSnapshot& histogram, uint64_t value, uint64_t expected_interval) {
+    histogram.Record(value);
+    if (expected_interval == 0) {
+        return;
+    }
+    for (uint64_t missing = value; missing > expected_interval;) {
+        missing -= expected_interval;
+        histogram.Record(missing);
+    }
+}
+
+void PrintLatency(string_view name, const HistogramSnapshot& histogram) {
+    cout << name << "_us:"
+         << " p50=" << histogram.GetPercentile(50) / 1000.0
+         << " p90=" << histogram.GetPercentile(90) / 1000.0
+         << " p99=" << histogram.GetPercentile(99) / 1000.0
+         << " p99.9=" << histogram.GetPercentile(99.9) / 1000.0
+         << " max=" << histogram.GetMax() / 1000.0
+         << " mean=" << histogram.GetMean() / 1000.0 << '\n';
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        const map<string, string> arguments = ParseArguments(argc, argv);
+        const auto get = [&arguments](const string& key, const string& default_value) {
+            const auto it = arguments.find(key);
+            return it == arguments.end() ? default_value : it->second;
+        };
+
+        ReplayOptions options;
+        options.target = get("target", options.target);
+        options.mode = get("mode", options.mode);
+        options.clients = max<size_t>(1, stoul(get("clients", "1")));
+        options.qps = stod(get("qps", "100"));
+        options.use_timestamps = arguments.count("use-timestamps") > 0;
+        options.speed = stod(get("speed", "1"));
+        options.batch = max<size_t>(1, stoul(get("batch", "16")));
+        if (options.target != "seq"sv && options.target != "par"sv
+            && options.target != "process"sv && options.target != "queue"sv) {
+            throw invalid_argument("Unknown target: "s + options.target);
+        }
+        if (options.mode != "open"sv && options.mode != "closed"sv) {
+            throw invalid_argument("Unknown mode: "s + options.mode);
+        }
+        if (options.qps <= 0 || options.speed <= 0) {
+            throw invalid_argument("--qps and --speed must be positive");
+        }
+
+        CorpusOptions corpus_options;
+        corpus_options.document_count = stoul(get("documents", "10000"));
+        const Corpus corpus = arguments.count("corpus") > 0 ? ReadCorpus(get("corpus", ""), get("stop-words", ""))
+                                                            : GenerateCorpus(corpus_options);
+        const vector<ReplayQuery> log = arguments.count("log") > 0
+                                            ? ReadQueryLog(get("log", ""))
+                                            : GenerateQueryLog(corpus_options, stoul(get("queries", "1000")));
+        options.requests = stoul(get("requests", to_string(log.size())));
+
+        const SearchServer search_server = BuildSearchServer(corpus);
+        const Clock::time_point start = Clock::now();
+        const vector<ClientResult> results = Replay(search_server, options, log);
+        const double elapsed = chrono::duration<double>(Clock::now() - start).count();
+
+        size_t query_count = 0;
+        size_t result_count = 0;
+        size_t error_count = 0;
+        string first_error;
+        HistogramSnapshot service_times;
+        HistogramSnapshot response_times;
+        for (const ClientResult& result : results) {
+            query_count += result.query_count;
+            result_count += result.result_count;
+            error_count += result.error_count;
+            if (first_error.empty()) {
+                first_error = result.first_error;
+            }
+            for (size_t i = 0; i < result.service_times.size(); ++i) {
+                service_times.Record(result.service_times[i]);
+                response_times.Record(result.response_times[i]);
+            }
+        }
+
+        // в закрытом режиме ожидаемый интервал между запросами клиента - медиана ответа
+        HistogramSnapshot corrected_times;
+        if (options.mode == "open"sv) {
+            corrected_times = response_times;
+        } else {
+            const uint64_t expected_interval = service_times.GetPercentile(50);
+            for (const ClientResult& result : results) {
+                for (const uint64_t value : result.response_times) {
+                    RecordCorrected(corrected_times, value, expected_interval);
+                }
+            }
+        }
+
+        cout << fixed << setprecision(1);
+        cout << "target=" << options.target << " mode=" << options.mode << " clients=" << options.clients;
+        if (options.mode == "open"sv) {
+            cout << " scheduled_qps=";
+            if (options.use_timestamps) {
+                cout << "log*" << options.speed;
+            } else {
+                cout << options.qps;
+            }
+        }
+        cout << '\n';
+        cout << "documents=" << search_server.GetDocumentCount() << " log_queries=" << log.size()
+             << " queries=" << query_count << " results=" << result_count << '\n';
+        cout << "elapsed_s=" << setprecision(3) << elapsed << setprecision(1)
+             << " achieved_qps=" << query_count / elapsed << " errors=" << error_count << '\n';
+        if (error_count > 0) {
+            cout << "first_error=" << first_error << '\n';
+        }
+        PrintLatency(options.target == "process"sv ? "batch_service"sv : "service"sv, service_times);
+        if (options.mode == "open"sv) {
+            PrintLatency("response"sv, response_times);
+        }
+        cout << "co_corrected_p99_us=" << corrected_times.GetPercentile(99) / 1000.0 << '\n';
+    } catch (const exception& error) {
+        cerr << error.what() << endl;
+        return 1;
+    }
+}
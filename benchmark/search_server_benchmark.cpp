@@ -0,0 +1,531 @@
+#include "corpus_generator.h"
+
+#include "paginator.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+#include "string_processing.h"
+#include "text_normalizer.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <execution>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t QUERY_COUNT = 1000;
+const size_t WORDS_PER_QUERY = 4;
+const double MINUS_WORD_RATIO = 0.15;
+
+CorpusOptions MakeOptions(size_t document_count) {
+    CorpusOptions options;
+    options.document_count = document_count;
+    return options;
+}
+
+const Corpus& GetCorpus(size_t document_count) {
+    static std::map<size_t, std::unique_ptr<Corpus>> cache;
+    auto& corpus = cache[document_count];
+    if (!corpus) {
+        corpus = std::make_unique<Corpus>(GenerateCorpus(MakeOptions(document_count)));
+    }
+    return *corpus;
+}
+
+const SearchServer& GetServer(size_t document_count) {
+    static std::map<size_t, std::unique_ptr<SearchServer>> cache;
+    auto& search_server = cache[document_count];
+    if (!search_server) {
+        search_server = std::make_unique<SearchServer>(BuildSearchServer(GetCorpus(document_count)));
+    }
+    return *search_server;
+}
+
+const std::vector<std::string>& GetQueries() {
+    static const std::vector<std::string> queries =
+        GenerateQueries(MakeOptions(0), QUERY_COUNT, WORDS_PER_QUERY, MINUS_WORD_RATIO, 7);
+    return queries;
+}
+
+bool IsEvenRatedDocument(int document_id, DocumentStatus status, int rating) {
+    return status == DocumentStatus::ACTUAL && rating % 2 == 0;
+}
+
+void DocumentCounts(benchmark::internal::Benchmark* b) {
+    b->Arg(1000)->Arg(10000);
+}
+
+// буквы a-z в кириллице, греческом и хирагане
+const std::string_view CYRILLIC_LETTERS[] = {
+    "а", "б", "ц", "д", "е", "ф", "г", "х", "и", "й", "к", "л", "м",
+    "н", "о", "п", "я", "р", "с", "т", "у", "в", "ш", "ж", "ы", "з"};
+const std::string_view CYRILLIC_CAPITALS[] = {
+    "А", "Б", "Ц", "Д", "Е", "Ф", "Г", "Х", "И", "Й", "К", "Л", "М",
+    "Н", "О", "П", "Я", "Р", "С", "Т", "У", "В", "Ш", "Ж", "Ы", "З"};
+const std::string_view GREEK_LETTERS[] = {
+    "α", "β", "ψ", "δ", "ε", "φ", "γ", "η", "ι", "ξ", "κ", "λ", "μ",
+    "ν", "ο", "π", "θ", "ρ", "σ", "τ", "υ", "ω", "ϊ", "χ", "ϋ", "ζ"};
+const std::string_view GREEK_CAPITALS[] = {
+    "Α", "Β", "Ψ", "Δ", "Ε", "Φ", "Γ", "Η", "Ι", "Ξ", "Κ", "Λ", "Μ",
+    "Ν", "Ο", "Π", "Θ", "Ρ", "Σ", "Τ", "Υ", "Ω", "Ϊ", "Χ", "Ϋ", "Ζ"};
+const std::string_view KANA_LETTERS[] = {
+    "あ", "い", "う", "え", "お", "か", "き", "く", "け", "こ", "さ", "し", "す",
+    "せ", "そ", "た", "ち", "つ", "て", "と", "な", "に", "ぬ", "ね", "の", "は"};
+
+// документ корпуса латиницей, кириллицей, греческим и хираганой (письменность выбирается по слову)
+// с заглавными буквами в начале предложений и знаками препинания
+std::string MakeMixedScriptDocument(std::string_view document) {
+    std::string result;
+    size_t position = 0;
+    bool is_sentence_start = true;
+    for (const std::string_view word : SplitIntoWords(document)) {
+        if (position > 0) {
+            result += ' ';
+        }
+        const size_t script = std::hash<std::string_view>{}(word) % 4;
+        for (size_t i = 0; i < word.size(); ++i) {
+            const bool is_capital = is_sentence_start && i == 0;
+            const size_t letter = word[i] - 'a';
+            if (script == 0) {
+                result += is_capital ? static_cast<char>('A' + letter) : word[i];
+            } else if (script == 1) {
+                result += (is_capital ? CYRILLIC_CAPITALS : CYRILLIC_LETTERS)[letter];
+            } else if (script == 2) {
+                result += (is_capital ? GREEK_CAPITALS : GREEK_LETTERS)[letter];
+            } else {
+                result += KANA_LETTERS[letter];
+            }
+        }
+        ++position;
+        is_sentence_start = position % 9 == 0;
+        if (is_sentence_start) {
+            result += '.';
+        } else if (position % 5 == 0) {
+            result += ',';
+        }
+    }
+    return result;
+}
+
+// script = 0 - документы корпуса, 1 - они же в четырёх письменностях
+const std::vector<std::string>& GetNormalizationDocuments(int64_t script) {
+    static std::map<int64_t, std::vector<std::string>> cache;
+    auto& documents = cache[script];
+    if (documents.empty()) {
+        documents = GetCorpus(1000).documents;
+        if (script == 1) {
+            std::transform(documents.begin(), documents.end(), documents.begin(), [](const std::string& document) {
+                return MakeMixedScriptDocument(document);
+            });
+        }
+    }
+    return documents;
+}
+
+size_t GetTotalSize(const std::vector<std::string>& documents) {
+    size_t size = 0;
+    for (const std::string& document : documents) {
+        size += document.size();
+    }
+    return size;
+}
+
+} // namespace
+
+static void BM_AddDocument(benchmark::State& state) {
+    const Corpus& corpus = GetCorpus(state.range(0));
+    for (auto _ : state) {
+        SearchServer search_server(corpus.stop_words);
+        for (size_t id = 0; id < corpus.documents.size(); ++id) {
+            search_server.AddDocument(static_cast<int>(id), corpus.documents[id],
+                                      corpus.statuses[id], corpus.ratings[id]);
+        }
+        benchmark::DoNotOptimize(search_server.GetDocumentCount());
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.documents.size());
+}
+BENCHMARK(BM_AddDocument)->Apply(DocumentCounts)->Unit(benchmark::kMillisecond);
+
+// range(0) = 0 - текст ASCII, 1 - в четырёх письменностях; range(1) = 0 - без кэша слов, 1 - с кэшем
+static void BM_NormalizeText(benchmark::State& state) {
+    const auto& documents = GetNormalizationDocuments(state.range(0));
+    TextNormalizerOptions options;
+    if (state.range(1) == 0) {
+        options.cache_size = 0;
+    }
+    const TextNormalizer normalizer(options);
+    std::string storage;
+    for (auto _ : state) {
+        for (const std::string& document : documents) {
+            benchmark::DoNotOptimize(normalizer.Split(document, storage));
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * GetTotalSize(documents));
+}
+BENCHMARK(BM_NormalizeText)->Args({0, 1})->Args({1, 0})->Args({1, 1});
+
+// range(0) - как в BM_NormalizeText; range(1) = 0 - без нормализации, 1 - с ней
+static void BM_AddDocumentNormalized(benchmark::State& state) {
+    const Corpus& corpus = GetCorpus(1000);
+    const auto& documents = GetNormalizationDocuments(state.range(0));
+    for (auto _ : state) {
+        SearchServer search_server(corpus.stop_words);
+        if (state.range(1) == 1) {
+            search_server.EnableTextNormalization();
+        }
+        for (size_t id = 0; id < documents.size(); ++id) {
+            search_server.AddDocument(static_cast<int>(id), documents[id], corpus.statuses[id], corpus.ratings[id]);
+        }
+        benchmark::DoNotOptimize(search_server.GetDocumentCount());
+    }
+    state.SetBytesProcessed(state.iterations() * GetTotalSize(documents));
+}
+BENCHMARK(BM_AddDocumentNormalized)->Args({0, 0})->Args({0, 1})->Args({1, 0})->Args({1, 1})->Unit(benchmark::kMillisecond);
+
+template <typename ExecutionPolicy>
+static void BM_FindTopDocumentsStatus(benchmark::State& state, const ExecutionPolicy& policy) {
+    const SearchServer& search_server = GetServer(state.range(0));
+    const auto& queries = GetQueries();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(search_server.FindTopDocuments(policy, queries[i++ % queries.size()],
+                                                                DocumentStatus::ACTUAL));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_FindTopDocumentsStatus, seq, std::execution::seq)->Apply(DocumentCounts);
+BENCHMARK_CAPTURE(BM_FindTopDocumentsStatus, par, std::execution::par)->Apply(DocumentCounts);
+
+// range(0) = 0 - TF-IDF, 1 - BM25
+static void BM_FindTopDocumentsScoring(benchmark::State& state) {
+    SearchServer search_server = BuildSearchServer(GetCorpus(10000));
+    if (state.range(0) == 1) {
+        search_server.SetScoringPolicy(Bm25Scoring{});
+    }
+    const auto& queries = GetQueries();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(search_server.FindTopDocuments(queries[i++ % queries.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindTopDocumentsScoring)->Arg(0)->Arg(1);
+
+template <typename ExecutionPolicy>
+static void BM_FindTopDocumentsLambda(benchmark::State& state, const ExecutionPolicy& policy) {
+    const SearchServer& search_server = GetServer(state.range(0));
+    const auto& queries = GetQueries();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(search_server.FindTopDocuments(policy, queries[i++ % queries.size()],
+                                                                [](int document_id, DocumentStatus status, int rating) {
+                                                                    return IsEvenRatedDocument(document_id, status, rating);
+                                                                }));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_FindTopDocumentsLambda, seq, std::execution::seq)->Apply(DocumentCounts);
+BENCHMARK_CAPTURE(BM_FindTopDocumentsLambda, par, std::execution::par)->Apply(DocumentCounts);
+
+static void BM_FindTopDocumentsPrepared(benchmark::State& state) {
+    const SearchServer& search_server = GetServer(state.range(0));
+    std::vector<PreparedQuery> queries;
+    for (const std::string& query : GetQueries()) {
+        queries.push_back(search_server.PrepareQuery(query));
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(search_server.FindTopDocuments(queries[i++ % queries.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindTopDocumentsPrepared)->Apply(DocumentCounts);
+
+// стоимость сбора SearchStats по сравнению с BM_FindTopDocumentsStatus
+template <typename ExecutionPolicy>
+static void BM_ExplainTopDocuments(benchmark::State& state, const ExecutionPolicy& policy) {
+    const SearchServer& search_server = GetServer(state.range(0));
+    const auto& queries = GetQueries();
+    SearchStats stats;
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(search_server.ExplainTopDocuments(policy, queries[i++ % queries.size()], stats));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_ExplainTopDocuments, seq, std::execution::seq)->Apply(DocumentCounts);
+BENCHMARK_CAPTURE(BM_ExplainTopDocuments, par, std::execution::par)->Apply(DocumentCounts);
+
+// короткие префиксы раскрываются в множество слов; state.range(0) - длина префикса в символах
+template <typename ExecutionPolicy>
+static void BM_FindTopDocumentsPrefix(benchmark::State& state, const ExecutionPolicy& policy) {
+    const SearchServer& search_server = GetServer(10000);
+    std::vector<std::string> queries;
+    for (size_t rank = 0; rank < 100; ++rank) {
+        const std::string word = MakeWord(rank * 37);
+        queries.push_back(word.substr(0, std::min<size_t>(word.size(), state.range(0))) + "*");
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(search_server.FindTopDocuments(policy, queries[i++ % queries.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_FindTopDocumentsPrefix, seq, std::execution::seq)->Arg(2)->Arg(4);
+BENCHMARK_CAPTURE(BM_FindTopDocumentsPrefix, par, std::execution::par)->Arg(2)->Arg(4);
+
+// запросы из одного слова с range(0) опечатками (замена буквы); точный поиск ничего не находит
+template <typename ExecutionPolicy>
+static void BM_FindTopDocumentsFuzzy(benchmark::State& state, const ExecutionPolicy& policy) {
+    static SearchServer search_server = [] {
+        SearchServer server = BuildSearchServer(GetCorpus(10000));
+        server.EnableFuzzyMatching();
+        return server;
+    }();
+    std::vector<std::string> queries;
+    for (size_t rank = 0; rank < 100; ++rank) {
+        std::string word = MakeWord(6400 + rank * 37);
+        for (int edit = 0; edit < state.range(0); ++edit) {
+            word[(edit * 3 + 1) % word.size()] = 'q';
+        }
+        queries.push_back(word);
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(search_server.FindTopDocuments(policy, queries[i++ % queries.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_FindTopDocumentsFuzzy, seq, std::execution::seq)->Arg(1)->Arg(2);
+BENCHMARK_CAPTURE(BM_FindTopDocumentsFuzzy, par, std::execution::par)->Arg(1)->Arg(2);
+
+// запросы из частых слов по индексу влияния; range(0) - бюджет просмотренных документов, 0 - без бюджета
+static void BM_FindTopDocumentsBudget(benchmark::State& state) {
+    static SearchServer search_server = [] {
+        SearchServer server = BuildSearchServer(GetCorpus(10000));
+        server.EnableImpactIndex();
+        return server;
+    }();
+    std::vector<std::string> queries;
+    for (size_t rank = 0; rank < 20; ++rank) {
+        queries.push_back(MakeWord(rank) + " " + MakeWord(rank + 20));
+    }
+    SearchBudget budget;
+    if (state.range(0) > 0) {
+        budget.max_postings = state.range(0);
+    }
+    size_t i = 0;
+    size_t exact_results = 0;
+    for (auto _ : state) {
+        const auto result = search_server.FindTopDocuments(queries[i++ % queries.size()], budget);
+        exact_results += result.is_exact;
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["exact_ratio"] = static_cast<double>(exact_results) / state.iterations();
+}
+BENCHMARK(BM_FindTopDocumentsBudget)->Arg(0)->Arg(100)->Arg(1000);
+
+// документы с обоими словами запроса: range(0) = 0 - поиск по любому слову и фильтр
+// предикатом, 1 - обязательные слова "+слово"; range(1) - ранг второго, более редкого слова
+static void BM_FindTopDocumentsRequired(benchmark::State& state) {
+    const SearchServer& search_server = GetServer(10000);
+    const size_t rare_rank = state.range(1);
+    std::vector<std::pair<std::string, std::string>> word_pairs;
+    for (size_t rank = 0; rank < 20; ++rank) {
+        word_pairs.emplace_back(MakeWord(rank), MakeWord(rare_rank + rank));
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        const auto& [frequent, rare] = word_pairs[i++ % word_pairs.size()];
+        if (state.range(0) == 0) {
+            benchmark::DoNotOptimize(search_server.FindTopDocuments(frequent + " " + rare,
+                [&](int document_id, DocumentStatus status, int rating) {
+                    const auto& word_freqs = search_server.GetWordFrequencies(document_id);
+                    return status == DocumentStatus::ACTUAL && word_freqs.count(frequent) > 0 && word_freqs.count(rare) > 0;
+                }));
+        } else {
+            benchmark::DoNotOptimize(search_server.FindTopDocuments("+" + frequent + " +" + rare));
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindTopDocumentsRequired)->Args({0, 20})->Args({1, 20})->Args({0, 500})->Args({1, 500});
+
+// повторяющиеся запросы из одного-двух частых слов; range(0) = 1 - с кэшем результатов
+static void BM_FindTopDocumentsCached(benchmark::State& state) {
+    SearchServer search_server = BuildSearchServer(GetCorpus(10000));
+    if (state.range(0) == 1) {
+        search_server.EnableResultCache();
+    }
+    std::vector<std::string> queries;
+    for (size_t rank = 0; rank < 50; ++rank) {
+        queries.push_back(MakeWord(rank));
+        queries.push_back(MakeWord(rank) + " " + MakeWord(rank + 50));
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(search_server.FindTopDocuments(queries[i++ % queries.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+    const ResultCacheStats stats = search_server.GetResultCacheStats();
+    state.counters["hit_ratio"] = static_cast<double>(stats.hits) / std::max<uint64_t>(state.iterations(), 1);
+}
+BENCHMARK(BM_FindTopDocumentsCached)->Arg(0)->Arg(1);
+
+template <typename ExecutionPolicy>
+static void BM_MatchDocument(benchmark::State& state, const ExecutionPolicy& policy) {
+    const SearchServer& search_server = GetServer(state.range(0));
+    const auto& queries = GetQueries();
+    const int document_count = search_server.GetDocumentCount();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(search_server.MatchDocument(policy, queries[i % queries.size()],
+                                                             static_cast<int>(i % document_count)));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_MatchDocument, seq, std::execution::seq)->Apply(DocumentCounts);
+BENCHMARK_CAPTURE(BM_MatchDocument, par, std::execution::par)->Apply(DocumentCounts);
+
+template <typename ExecutionPolicy>
+static void BM_MatchDocuments(benchmark::State& state, const ExecutionPolicy& policy) {
+    const SearchServer& search_server = GetServer(10000);
+    const auto& queries = GetQueries();
+    std::vector<int> document_ids;
+    for (int id = 0; id < state.range(0); ++id) {
+        document_ids.push_back(id * 7 % search_server.GetDocumentCount());
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(search_server.MatchDocuments(policy, queries[i++ % queries.size()], document_ids));
+    }
+    state.SetItemsProcessed(state.iterations() * document_ids.size());
+}
+BENCHMARK_CAPTURE(BM_MatchDocuments, seq, std::execution::seq)->Arg(50)->Arg(5000);
+BENCHMARK_CAPTURE(BM_MatchDocuments, par, std::execution::par)->Arg(50)->Arg(5000);
+
+template <typename ExecutionPolicy>
+static void BM_RemoveDocument(benchmark::State& state, const ExecutionPolicy& policy) {
+    const SearchServer& original = GetServer(state.range(0));
+    const int document_count = original.GetDocumentCount();
+    for (auto _ : state) {
+        state.PauseTiming();
+        SearchServer search_server = original;
+        state.ResumeTiming();
+        for (int id = 0; id < document_count; id += 10) {
+            search_server.RemoveDocument(policy, id);
+        }
+        benchmark::DoNotOptimize(search_server.GetDocumentCount());
+    }
+    state.SetItemsProcessed(state.iterations() * (document_count + 9) / 10);
+}
+BENCHMARK_CAPTURE(BM_RemoveDocument, seq, std::execution::seq)->Apply(DocumentCounts)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_RemoveDocument, par, std::execution::par)->Apply(DocumentCounts)->Unit(benchmark::kMillisecond);
+
+static void BM_RemoveDuplicates(benchmark::State& state) {
+    const SearchServer& original = GetServer(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        SearchServer search_server = original;
+        state.ResumeTiming();
+        RemoveDuplicates(search_server);
+        benchmark::DoNotOptimize(search_server.GetDocumentCount());
+    }
+}
+BENCHMARK(BM_RemoveDuplicates)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+static void BM_ProcessQueries(benchmark::State& state) {
+    const SearchServer& search_server = GetServer(state.range(0));
+    const auto& queries = GetQueries();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ProcessQueries(search_server, queries));
+    }
+    state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_ProcessQueries)->Apply(DocumentCounts)->Unit(benchmark::kMillisecond);
+
+// пачка из range(1) запросов (слова по Ципфу, поэтому частые слова общие у многих запросов):
+// range(0) = 0 - каждый запрос отдельно, 1 - FindTopDocumentsBatch
+static void BM_QueryBatch(benchmark::State& state) {
+    const SearchServer& search_server = GetServer(10000);
+    const std::vector<std::string> queries =
+        GenerateQueries(MakeOptions(0), state.range(1), WORDS_PER_QUERY, MINUS_WORD_RATIO, 17);
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            std::vector<std::vector<Document>> results(queries.size());
+            std::transform(queries.begin(), queries.end(), results.begin(), [&search_server](const std::string& query) {
+                return search_server.FindTopDocuments(query);
+            });
+            benchmark::DoNotOptimize(results);
+        } else {
+            benchmark::DoNotOptimize(search_server.FindTopDocumentsBatch(std::execution::seq, queries));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_QueryBatch)
+    ->Args({0, 100})->Args({1, 100})
+    ->Args({0, 1000})->Args({1, 1000})
+    ->Args({1, 10000})
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_Paginate(benchmark::State& state) {
+    const SearchServer& search_server = GetServer(10000);
+    std::vector<Document> documents;
+    for (const std::string& query : GetQueries()) {
+        for (const Document& document : search_server.FindTopDocuments(query)) {
+            documents.push_back(document);
+        }
+    }
+    for (auto _ : state) {
+        const auto pages = Paginate(documents, state.range(0));
+        benchmark::DoNotOptimize(pages.size());
+    }
+    state.SetItemsProcessed(state.iterations() * documents.size());
+}
+BENCHMARK(BM_Paginate)->Arg(2)->Arg(20);
+
+// страница state.range(0) по 20 документов: по смещению и по курсору предыдущей страницы
+static void BM_FindTopDocumentsPage(benchmark::State& state) {
+    const SearchServer& search_server = GetServer(10000);
+    const auto& queries = GetQueries();
+    const size_t page_size = 20;
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(search_server.FindTopDocumentsPage(
+            std::execution::seq, queries[i++ % queries.size()],
+            PageRequest{state.range(0) * page_size, page_size, std::nullopt}));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindTopDocumentsPage)->Arg(0)->Arg(39);
+
+static void BM_LazyPaginatorFirstPages(benchmark::State& state) {
+    const SearchServer& search_server = GetServer(10000);
+    const auto& queries = GetQueries();
+    size_t i = 0;
+    for (auto _ : state) {
+        const std::string& query = queries[i++ % queries.size()];
+        auto pages = PaginateLazily([&search_server, &query](const PageRequest& request) {
+            return search_server.FindTopDocumentsPage(std::execution::seq, query, request);
+        }, 20);
+        size_t page_count = 0;
+        for (auto it = pages.begin(); it != pages.end() && page_count < static_cast<size_t>(state.range(0)); ++it) {
+            benchmark::DoNotOptimize(it->size());
+            ++page_count;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LazyPaginatorFirstPages)->Arg(3);
+
+BENCHMARK_MAIN();
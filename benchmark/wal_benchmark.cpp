@@ -0,0 +1,154 @@
+#include "corpus_generator.h"
+#include "durable_search_server.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t DOCUMENT_COUNT = 10000;
+
+enum IngestMode {
+    IN_MEMORY,
+    // изменения сбрасываются группами в фоне
+    DURABLE_ASYNC,
+    // каждое изменение ждёт fdatasync своей группы
+    DURABLE_WAIT,
+};
+
+const Corpus& GetCorpus() {
+    static const Corpus corpus = [] {
+        CorpusOptions options;
+        options.document_count = DOCUMENT_COUNT;
+        return GenerateCorpus(options);
+    }();
+    return corpus;
+}
+
+std::string GetStopWordsText() {
+    std::string text;
+    for (const std::string& word : GetCorpus().stop_words) {
+        text += word + ' ';
+    }
+    return text;
+}
+
+// временный каталог журнала, удаляется вместе с объектом
+class TemporaryDirectory {
+public:
+    TemporaryDirectory() {
+        std::string pattern = (std::filesystem::temp_directory_path() / "search_server_wal_XXXXXX").string();
+        path_ = mkdtemp(pattern.data());
+    }
+
+    ~TemporaryDirectory() {
+        std::filesystem::remove_all(path_);
+    }
+
+    const std::string& GetPath() const {
+        return path_;
+    }
+
+private:
+    std::string path_;
+};
+
+DurableSearchOptions MakeOptions(bool wait_for_commit) {
+    DurableSearchOptions options;
+    options.wait_for_commit = wait_for_commit;
+    return options;
+}
+
+} // namespace
+
+// добавление документов: range(0) - IngestMode
+static void BM_Ingest(benchmark::State& state) {
+    const Corpus& corpus = GetCorpus();
+    const std::string stop_words = GetStopWordsText();
+    const auto mode = static_cast<IngestMode>(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        TemporaryDirectory directory;
+        state.ResumeTiming();
+        if (mode == IN_MEMORY) {
+            SearchServer search_server(stop_words);
+            for (size_t id = 0; id < corpus.documents.size(); ++id) {
+                search_server.AddDocument(static_cast<int>(id), corpus.documents[id],
+                                          corpus.statuses[id], corpus.ratings[id]);
+            }
+            benchmark::DoNotOptimize(search_server.GetDocumentCount());
+        } else {
+            DurableSearchServer search_server(directory.GetPath(), stop_words, MakeOptions(mode == DURABLE_WAIT));
+            for (size_t id = 0; id < corpus.documents.size(); ++id) {
+                search_server.AddDocument(static_cast<int>(id), corpus.documents[id],
+                                          corpus.statuses[id], corpus.ratings[id]);
+            }
+            search_server.Sync();
+            state.counters["syncs"] = static_cast<double>(search_server.GetLog().GetSyncCount());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.documents.size());
+}
+BENCHMARK(BM_Ingest)->Arg(IN_MEMORY)->Arg(DURABLE_ASYNC)->Arg(DURABLE_WAIT)->Unit(benchmark::kMillisecond);
+
+// групповая фиксация: потоки добавляют документы и ждут записи на диск,
+// один fdatasync подтверждает изменения нескольких потоков
+static void BM_IngestConcurrent(benchmark::State& state) {
+    static std::unique_ptr<TemporaryDirectory> directory;
+    static std::unique_ptr<DurableSearchServer> search_server;
+    const Corpus& corpus = GetCorpus();
+    if (state.thread_index() == 0) {
+        directory = std::make_unique<TemporaryDirectory>();
+        search_server = std::make_unique<DurableSearchServer>(directory->GetPath(), GetStopWordsText(), MakeOptions(true));
+    }
+
+    int id = state.thread_index();
+    for (auto _ : state) {
+        const size_t source = static_cast<size_t>(id) % corpus.documents.size();
+        search_server->AddDocument(id, corpus.documents[source], corpus.statuses[source], corpus.ratings[source]);
+        id += state.threads();
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0) {
+        state.counters["syncs"] = static_cast<double>(search_server->GetLog().GetSyncCount());
+        search_server.reset();
+        directory.reset();
+    }
+}
+BENCHMARK(BM_IngestConcurrent)->Threads(1)->Threads(4)->Threads(16)->UseRealTime();
+
+// восстановление при запуске: range(0) = 0 - из журнала, 1 - из снимка
+static void BM_Recovery(benchmark::State& state) {
+    const Corpus& corpus = GetCorpus();
+    const std::string stop_words = GetStopWordsText();
+    TemporaryDirectory directory;
+    {
+        DurableSearchServer search_server(directory.GetPath(), stop_words, MakeOptions(false));
+        for (size_t id = 0; id < corpus.documents.size(); ++id) {
+            search_server.AddDocument(static_cast<int>(id), corpus.documents[id],
+                                      corpus.statuses[id], corpus.ratings[id]);
+        }
+        // каждый четвёртый документ удалён: при восстановлении он не индексируется
+        for (size_t id = 0; id < corpus.documents.size(); id += 4) {
+            search_server.RemoveDocument(static_cast<int>(id));
+        }
+        if (state.range(0) == 1) {
+            search_server.Checkpoint();
+        }
+    }
+
+    for (auto _ : state) {
+        DurableSearchServer search_server(directory.GetPath(), stop_words, MakeOptions(false));
+        benchmark::DoNotOptimize(search_server.GetSearchServer().GetDocumentCount());
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.documents.size());
+}
+BENCHMARK(BM_Recovery)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
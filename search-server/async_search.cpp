@@ -0,0 +1,114 @@
+#include "async_search.h"
+
+#include <algorithm>
+#include <execution>
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer& search_server, const AsyncSearchOptions& options)
+    : search_server_(search_server)
+    , queue_capacity_(options.queue_capacity) {
+    size_t worker_count = options.worker_count;
+    if (worker_count == 0) {
+        worker_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers_.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers_.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+AsyncSearchServer::~AsyncSearchServer() {
+    std::deque<Task> pending;
+    {
+        std::lock_guard guard(mutex_);
+        stop_ = true;
+        pending.swap(queue_);
+        for (const auto& control : running_) {
+            control->Cancel();
+        }
+    }
+    queue_not_empty_.notify_all();
+
+    for (Task& task : pending) {
+        task.promise.set_value({{}, SearchOutcome::CANCELLED});
+    }
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+AsyncSearchRequest AsyncSearchServer::Submit(std::string raw_query, Clock::time_point deadline, DocumentStatus status) {
+    return Submit(std::move(raw_query), deadline, [status](int document_id, DocumentStatus document_status, int rating) {
+        return document_status == status;
+    });
+}
+
+AsyncSearchRequest AsyncSearchServer::Submit(std::string raw_query, Clock::time_point deadline, DocumentPredicate document_predicate) {
+    // некорректный запрос - исключение здесь, а не в потоке пула
+    search_server_.PrepareQuery(raw_query);
+
+    auto control = std::make_shared<SearchControl>(deadline);
+    std::promise<AsyncSearchResult> promise;
+    AsyncSearchRequest request(promise.get_future(), control);
+
+    // отказываем сразу, а не после ожидания в переполненной очереди
+    SearchOutcome rejection = SearchOutcome::REJECTED;
+    {
+        std::lock_guard guard(mutex_);
+        if (control->ShouldStop()) {
+            rejection = control->GetOutcome();
+        } else if (!stop_ && queue_.size() < queue_capacity_) {
+            queue_.push_back({std::move(raw_query), std::move(document_predicate), std::move(control), std::move(promise)});
+            rejection = SearchOutcome::COMPLETED;
+        }
+    }
+    if (rejection == SearchOutcome::COMPLETED) {
+        queue_not_empty_.notify_one();
+    } else {
+        promise.set_value({{}, rejection});
+    }
+    return request;
+}
+
+size_t AsyncSearchServer::GetQueueSize() const {
+    std::lock_guard guard(mutex_);
+    return queue_.size();
+}
+
+void AsyncSearchServer::WorkerLoop() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock lock(mutex_);
+            queue_not_empty_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (stop_) {
+                return;
+            }
+            task = std::move(queue_.front());
+            queue_.pop_front();
+            running_.push_back(task.control);
+        }
+        RunningGuard running_guard{this, task.control.get()};
+
+        AsyncSearchResult result;
+        try {
+            // запрос, просроченный в очереди, не выполняется
+            if (!task.control->ShouldStop()) {
+                result.documents = search_server_.FindTopDocuments(std::execution::seq, task.raw_query,
+                                                                   task.document_predicate, *task.control);
+            }
+            result.outcome = task.control->GetOutcome();
+        } catch (...) {
+            task.promise.set_exception(std::current_exception());
+            continue;
+        }
+        task.promise.set_value(std::move(result));
+    }
+}
+
+AsyncSearchServer::RunningGuard::~RunningGuard() {
+    std::lock_guard guard(server->mutex_);
+    auto& running = server->running_;
+    running.erase(std::find_if(running.begin(), running.end(), [this](const auto& running_control) {
+        return running_control.get() == control;
+    }));
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "search_server.h"
+#include "search_control.h"
+#include "document.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct AsyncSearchOptions {
+    // 0 - по числу аппаратных потоков
+    size_t worker_count = 0;
+    // запросы сверх этого числа ожидающих отклоняются сразу
+    size_t queue_capacity = 64;
+};
+
+struct AsyncSearchResult {
+    std::vector<Document> documents;
+    // при DEADLINE_EXCEEDED и CANCELLED documents - лучшие из оценённых до остановки
+    SearchOutcome outcome = SearchOutcome::COMPLETED;
+};
+
+// запрос, поставленный в очередь AsyncSearchServer
+class AsyncSearchRequest {
+public:
+    std::future<AsyncSearchResult>& GetFuture() {
+        return future_;
+    }
+
+    // просит прекратить поиск; результат всё равно придёт через future
+    void Cancel() {
+        control_->Cancel();
+    }
+
+private:
+    friend class AsyncSearchServer;
+
+    AsyncSearchRequest(std::future<AsyncSearchResult> future, std::shared_ptr<SearchControl> control)
+        : future_(std::move(future))
+        , control_(std::move(control)) {
+    }
+
+    std::future<AsyncSearchResult> future_;
+    std::shared_ptr<SearchControl> control_;
+};
+
+/**
+ * Асинхронный поиск поверх SearchServer: запросы выполняются пулом потоков
+ * из ограниченной очереди. У каждого запроса есть срок; просроченный в очереди
+ * запрос не выполняется, а просроченный во время поиска возвращает лучшие
+ * из уже оценённых документов.
+ *
+ * Индекс search_server не должен меняться, пока работает AsyncSearchServer.
+ */
+class AsyncSearchServer {
+public:
+    using Clock = SearchControl::Clock;
+    using DocumentPredicate = std::function<bool(int, DocumentStatus, int)>;
+
+    explicit AsyncSearchServer(const SearchServer& search_server, const AsyncSearchOptions& options = {});
+
+    // ожидающие запросы завершаются с CANCELLED, выполняемые - прерываются
+    ~AsyncSearchServer();
+
+    AsyncSearchServer(const AsyncSearchServer&) = delete;
+    AsyncSearchServer& operator=(const AsyncSearchServer&) = delete;
+
+    // некорректный запрос отклоняется исключением std::invalid_argument до постановки в очередь;
+    // исключение, возникшее при поиске, передаётся через future
+    AsyncSearchRequest Submit(std::string raw_query, Clock::time_point deadline,
+                              DocumentStatus status = DocumentStatus::ACTUAL);
+
+    AsyncSearchRequest Submit(std::string raw_query, Clock::time_point deadline,
+                              DocumentPredicate document_predicate);
+
+    size_t GetQueueSize() const;
+
+private:
+    struct Task {
+        std::string raw_query;
+        DocumentPredicate document_predicate;
+        std::shared_ptr<SearchControl> control;
+        std::promise<AsyncSearchResult> promise;
+    };
+
+    // убирает запрос из running_ при выходе из области видимости
+    struct RunningGuard {
+        AsyncSearchServer* server;
+        const SearchControl* control;
+
+        ~RunningGuard();
+    };
+
+    void WorkerLoop();
+
+    const SearchServer& search_server_;
+    const size_t queue_capacity_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable queue_not_empty_;
+    std::deque<Task> queue_;
+    // выполняемые сейчас запросы, чтобы прервать их при остановке
+    std::vector<std::shared_ptr<SearchControl>> running_;
+    bool stop_ = false;
+    std::vector<std::thread> workers_;
+};
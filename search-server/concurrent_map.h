@@ -37,11 +37,11 @@ public:
         return {key, bucket};
     };
 
-    void Erase(const Key& key) {
+    size_t Erase(const Key& key) {
         uint64_t id = key;
         Bucket& bucket = buckets_[id % buckets_.size()];
         std::lock_guard guard(bucket.mutex_value);
-        bucket.container.erase(key);
+        return bucket.container.erase(key);
     }
 
     std::map<Key, Value> BuildOrdinaryMap() {
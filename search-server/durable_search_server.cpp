@@ -0,0 +1,177 @@
+#include "durable_search_server.h"
+#include "shard_protocol.h"
+
+#include <algorithm>
+#include <execution>
+#include <filesystem>
+#include <iterator>
+#include <map>
+
+namespace {
+
+// последнее состояние каждого документа по записям снимка и журналов
+struct LiveDocuments {
+    std::map<int, WalRecord> added;
+    uint64_t last_lsn = 0;
+    size_t record_count = 0;
+
+    // записи с номером не больше skip_through уже вошли в снимок
+    void Apply(std::vector<WalRecord>& records, uint64_t skip_through) {
+        record_count += records.size();
+        for (WalRecord& record : records) {
+            last_lsn = std::max(last_lsn, record.lsn);
+            if (record.lsn <= skip_through && record.type != WalRecordType::CHECKPOINT) {
+                continue;
+            }
+            switch (record.type) {
+            case WalRecordType::ADD_DOCUMENT: {
+                const int document_id = PayloadReader(record.payload).ReadInt32();
+                added[document_id] = std::move(record);
+                break;
+            }
+            case WalRecordType::REMOVE_DOCUMENT:
+                added.erase(PayloadReader(record.payload).ReadInt32());
+                break;
+            case WalRecordType::CHECKPOINT:
+                break;
+            }
+        }
+    }
+
+    // записи добавления в порядке номеров, чтобы снимок не зависел от id
+    std::vector<WalRecord> TakeRecords() {
+        std::vector<WalRecord> records;
+        records.reserve(added.size());
+        for (auto& [document_id, record] : added) {
+            records.push_back(std::move(record));
+        }
+        std::sort(records.begin(), records.end(), [](const WalRecord& lhs, const WalRecord& rhs) {
+            return lhs.lsn < rhs.lsn;
+        });
+        added.clear();
+        return records;
+    }
+};
+
+// номер последней записи журнала, вошедшей в снимок
+uint64_t GetSnapshotLsn(const std::vector<WalRecord>& snapshot) {
+    if (snapshot.empty() || snapshot.front().type != WalRecordType::CHECKPOINT) {
+        return 0;
+    }
+    return snapshot.front().lsn;
+}
+
+std::string EncodeRemoveDocument(int document_id) {
+    PayloadWriter writer;
+    writer.WriteInt32(document_id);
+    return std::move(writer.GetData());
+}
+
+} // namespace
+
+DurableSearchServer::DurableSearchServer(const std::string& directory, const std::string& stop_words_text,
+                                         const DurableSearchOptions& options)
+    : snapshot_path_(directory + "/snapshot")
+    , log_path_(directory + "/wal")
+    , checkpoint_log_path_(directory + "/wal.checkpoint")
+    , wait_for_commit_(options.wait_for_commit)
+    , search_server_(stop_words_text) {
+    if (options.text_normalization) {
+        search_server_.EnableTextNormalization(*options.text_normalization);
+    }
+    std::filesystem::create_directories(directory);
+
+    WalReadResult snapshot = ReadWriteAheadLog(snapshot_path_);
+    WalReadResult checkpoint_log = ReadWriteAheadLog(checkpoint_log_path_);
+    WalReadResult log = ReadWriteAheadLog(log_path_);
+    const uint64_t snapshot_lsn = GetSnapshotLsn(snapshot.records);
+
+    LiveDocuments live;
+    live.Apply(snapshot.records, 0);
+    live.Apply(checkpoint_log.records, snapshot_lsn);
+    live.Apply(log.records, snapshot_lsn);
+    const uint64_t last_lsn = live.last_lsn;
+    recovery_stats_.record_count = live.record_count;
+
+    // разбор записей независим, в индекс документы добавляются по одному
+    const std::vector<WalRecord> records = live.TakeRecords();
+    std::vector<AddDocumentRequest> documents(records.size());
+    std::transform(std::execution::par, records.begin(), records.end(), documents.begin(), [](const WalRecord& record) {
+        return DecodeAddDocument(record.payload);
+    });
+    for (const AddDocumentRequest& document : documents) {
+        search_server_.AddDocument(document.document_id, document.document, document.status, document.ratings);
+    }
+    recovery_stats_.document_count = documents.size();
+
+    // прошлый Checkpoint прервался до записи снимка
+    if (std::filesystem::exists(checkpoint_log_path_)) {
+        WriteSnapshot();
+    }
+    log_ = std::make_unique<WriteAheadLog>(log_path_, log.valid_bytes, last_lsn + 1, options.log);
+}
+
+void DurableSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                      const std::vector<int>& ratings) {
+    uint64_t lsn = 0;
+    {
+        std::lock_guard lock(update_mutex_);
+        search_server_.AddDocument(document_id, document, status, ratings);
+        try {
+            lsn = log_->Append(WalRecordType::ADD_DOCUMENT,
+                               EncodeAddDocument({document_id, std::string(document), status, ratings}));
+        } catch (...) {
+            search_server_.RemoveDocument(document_id);
+            throw;
+        }
+    }
+    if (wait_for_commit_) {
+        log_->WaitDurable(lsn);
+    }
+}
+
+void DurableSearchServer::RemoveDocument(int document_id) {
+    uint64_t lsn = 0;
+    {
+        std::lock_guard lock(update_mutex_);
+        lsn = log_->Append(WalRecordType::REMOVE_DOCUMENT, EncodeRemoveDocument(document_id));
+        search_server_.RemoveDocument(document_id);
+    }
+    if (wait_for_commit_) {
+        log_->WaitDurable(lsn);
+    }
+}
+
+void DurableSearchServer::Sync() {
+    log_->Sync();
+}
+
+void DurableSearchServer::Checkpoint() {
+    std::lock_guard lock(checkpoint_mutex_);
+    // иначе Rotate затёр бы журнал, ещё не вошедший в снимок
+    if (std::filesystem::exists(checkpoint_log_path_)) {
+        WriteSnapshot();
+    }
+    // изменения после Rotate идут в новый журнал и в этот снимок не попадают
+    log_->Rotate(checkpoint_log_path_);
+    WriteSnapshot();
+}
+
+void DurableSearchServer::WriteSnapshot() const {
+    WalReadResult snapshot = ReadWriteAheadLog(snapshot_path_);
+    WalReadResult checkpoint_log = ReadWriteAheadLog(checkpoint_log_path_);
+    const uint64_t snapshot_lsn = GetSnapshotLsn(snapshot.records);
+
+    LiveDocuments live;
+    live.Apply(snapshot.records, 0);
+    live.Apply(checkpoint_log.records, snapshot_lsn);
+
+    std::vector<WalRecord> records;
+    records.push_back({live.last_lsn, WalRecordType::CHECKPOINT, {}});
+    std::vector<WalRecord> documents = live.TakeRecords();
+    std::move(documents.begin(), documents.end(), std::back_inserter(records));
+    WriteWalFile(snapshot_path_, records);
+
+    // если удаление не дойдёт до диска, записи журнала пропустятся по номеру снимка
+    std::filesystem::remove(checkpoint_log_path_);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "document.h"
+#include "search_server.h"
+#include "write_ahead_log.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct DurableSearchOptions {
+    WriteAheadLogOptions log;
+    // AddDocument и RemoveDocument возвращаются после записи изменения на диск;
+    // если false - при сбое теряются изменения последних commit_interval
+    bool wait_for_commit = true;
+    // см. SearchServer::EnableTextNormalization; как и стоп-слова, не меняется между запусками
+    std::optional<TextNormalizerOptions> text_normalization;
+};
+
+struct RecoveryStats {
+    // записи снимка и журнала, прочитанные при запуске
+    size_t record_count = 0;
+    // документы, добавленные в индекс (без удалённых позже в журнале)
+    size_t document_count = 0;
+};
+
+/**
+ * SearchServer, изменения которого переживают сбой процесса. Каталог
+ * directory хранит снимок (snapshot) и журнал упреждающей записи (wal).
+ * При создании индекс восстанавливается: из снимка и журнала остаётся
+ * последнее состояние каждого документа, и в индекс попадают только
+ * документы, не удалённые позже.
+ *
+ * Checkpoint сливает журнал в новый снимок и начинает журнал заново.
+ * Стоп-слова должны совпадать при всех запусках над одним каталогом.
+ * Изменения из нескольких потоков безопасны, поиск во время изменений - нет.
+ *
+ * Изменение попадает в индекс до записи на диск. Если запись не удалась,
+ * AddDocument или RemoveDocument бросает std::system_error, а изменение
+ * остаётся в индексе: оно могло дойти до диска, и откат разошёлся бы с тем,
+ * что восстановится. Журнал после ошибки отказывает во всех изменениях
+ * (они бросают std::system_error, не меняя индекс), и индекс остаётся доступен
+ * только для поиска; достоверное состояние даёт новый DurableSearchServer над тем же каталогом.
+ */
+class DurableSearchServer {
+public:
+    DurableSearchServer(const std::string& directory, const std::string& stop_words_text,
+                        const DurableSearchOptions& options = {});
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    // ждёт записи на диск всех сделанных изменений
+    void Sync();
+
+    void Checkpoint();
+
+    const SearchServer& GetSearchServer() const {
+        return search_server_;
+    }
+
+    const RecoveryStats& GetRecoveryStats() const {
+        return recovery_stats_;
+    }
+
+    const WriteAheadLog& GetLog() const {
+        return *log_;
+    }
+
+private:
+    // сливает снимок и журнал, отложенный Checkpoint, в новый снимок и удаляет этот журнал
+    void WriteSnapshot() const;
+
+    const std::string snapshot_path_;
+    const std::string log_path_;
+    // журнал, переименованный Checkpoint и ещё не вошедший в снимок
+    const std::string checkpoint_log_path_;
+    const bool wait_for_commit_;
+
+    SearchServer search_server_;
+    RecoveryStats recovery_stats_;
+    std::mutex update_mutex_;
+    std::mutex checkpoint_mutex_;
+    std::unique_ptr<WriteAheadLog> log_;
+};
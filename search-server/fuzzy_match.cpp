@@ -0,0 +1,31 @@
+#include "fuzzy_match.h"
+
+#include <algorithm>
+
+LevenshteinAutomaton::LevenshteinAutomaton(std::string_view pattern, int max_distance)
+    : pattern_(pattern)
+    , max_distance_(max_distance) {
+}
+
+LevenshteinAutomaton::State LevenshteinAutomaton::Start() const {
+    State state(pattern_.size() + 1);
+    for (size_t i = 0; i < state.size(); ++i) {
+        state[i] = std::min(static_cast<int>(i), max_distance_ + 1);
+    }
+    return state;
+}
+
+void LevenshteinAutomaton::Step(const State& state, char c, State& next) const {
+    next.resize(state.size());
+    next[0] = std::min(state[0] + 1, max_distance_ + 1);
+    for (size_t i = 1; i < state.size(); ++i) {
+        const int replace = state[i - 1] + (pattern_[i - 1] == c ? 0 : 1);
+        const int insert = state[i] + 1;
+        const int remove = next[i - 1] + 1;
+        next[i] = std::min({replace, insert, remove, max_distance_ + 1});
+    }
+}
+
+bool LevenshteinAutomaton::CanMatch(const State& state) const {
+    return *std::min_element(state.begin(), state.end()) <= max_distance_;
+}
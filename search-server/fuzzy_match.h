@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// настройки поиска с опечатками (см. SearchServer::EnableFuzzyMatching)
+struct FuzzyMatchOptions {
+    // наибольшее расстояние Левенштейна (1 или 2)
+    int max_distance = 2;
+    // слова короче не исправляются
+    size_t min_word_length = 3;
+    // слова короче исправляются не больше чем на одну правку
+    size_t min_word_length_for_two_edits = 6;
+    // нечёткий поиск выполняется, только если точный нашёл меньше документов
+    size_t min_results = 1;
+    // вес слова с расстоянием d умножается на distance_penalty^d
+    double distance_penalty = 0.5;
+    // сколько ближайших слов словаря подставляется вместо слова с опечаткой
+    size_t max_expansions = 16;
+    // время на обход словаря для всех слов запроса
+    std::chrono::microseconds time_budget{2000};
+};
+
+/**
+ * Автомат Левенштейна: состояние - строка матрицы расстояний между
+ * pattern и прочитанным префиксом слова. Значения больше max_distance
+ * обрезаются, поэтому состояние из которого нельзя прийти в допуск
+ * распознаётся сразу и всё поддерево словаря с этим префиксом пропускается.
+ */
+class LevenshteinAutomaton {
+public:
+    using State = std::vector<int>;
+
+    LevenshteinAutomaton(std::string_view pattern, int max_distance);
+
+    State Start() const;
+
+    // переход по символу c; next переиспользует память между вызовами
+    void Step(const State& state, char c, State& next) const;
+
+    // прочитанное слово находится в допуске
+    bool IsMatch(const State& state) const {
+        return state.back() <= max_distance_;
+    }
+
+    // у прочитанного префикса есть продолжения в допуске
+    bool CanMatch(const State& state) const;
+
+    int GetDistance(const State& state) const {
+        return state.back();
+    }
+
+    int GetMaxDistance() const {
+        return max_distance_;
+    }
+
+private:
+    std::string pattern_;
+    int max_distance_;
+};
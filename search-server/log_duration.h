@@ -1,5 +1,7 @@
 #pragma once
 
+#include "trace.h"
+
 #include <chrono>
 #include <iostream>
 #include <string_view>
@@ -46,28 +48,31 @@
  */
 #define LOG_DURATION_STREAM(x, y) LogDuration UNIQUE_VAR_NAME_PROFILE(x, y)
 
+/**
+ * Тонкая обёртка над ScopedTrace: время также попадает в гистограмму
+ * узла id (см. trace.h).
+ */
 class LogDuration {
 public:
     // заменим имя типа std::chrono::steady_clock
     // с помощью using для удобства
-    using Clock = std::chrono::steady_clock;
+    using Clock = ScopedTrace::Clock;
 
     LogDuration(std::string_view id, std::ostream& dst_stream = std::cerr)
         : id_(id)
-        , dst_stream_(dst_stream) {
+        , dst_stream_(dst_stream)
+        , trace_(InternTraceName(id)) {
     }
 
     ~LogDuration() {
         using namespace std::chrono;
         using namespace std::literals;
 
-        const auto end_time = Clock::now();
-        const auto dur = end_time - start_time_;
-        dst_stream_ << id_ << ": "sv << duration_cast<milliseconds>(dur).count() << " ms"sv << std::endl;
+        dst_stream_ << id_ << ": "sv << duration_cast<milliseconds>(trace_.GetElapsed()).count() << " ms\n"sv;
     }
 
 private:
     const std::string id_;
-    const Clock::time_point start_time_ = Clock::now();
     std::ostream& dst_stream_;
+    const ScopedTrace trace_;
 };
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "paginator.h"
+#include "document.h"
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+/**
+ * Результат SearchServer::MatchDocuments: совпавшие слова запроса
+ * для пачки документов в одном плоском буфере.
+ *
+ * Документы упорядочены по возрастанию id (повторы убираются),
+ * слова i-го документа лежат в words[word_offsets[i], word_offsets[i + 1]).
+ */
+struct MatchedDocuments {
+    std::vector<int> document_ids;
+    std::vector<DocumentStatus> statuses;
+    std::vector<size_t> word_offsets;
+    std::vector<std::string_view> words;
+
+    size_t size() const {
+        return document_ids.size();
+    }
+
+    IteratorRange<std::vector<std::string_view>::const_iterator> GetWords(size_t index) const {
+        return {words.begin() + word_offsets[index], words.begin() + word_offsets[index + 1]};
+    }
+};
@@ -0,0 +1,70 @@
+#include "memory_resources.h"
+
+#include <algorithm>
+#include <memory>
+
+void* CountingMemoryResource::do_allocate(size_t bytes, size_t alignment) {
+    void* p = upstream_->allocate(bytes, alignment);
+    allocation_count_.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    return p;
+}
+
+void CountingMemoryResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    upstream_->deallocate(p, bytes, alignment);
+    deallocated_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+bool CountingMemoryResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+namespace {
+
+const size_t INITIAL_BLOCK_SIZE = 16 * 1024;
+// больший блок не держим в каждом потоке, редкие тяжёлые запросы берут память из кучи
+const size_t MAX_BLOCK_SIZE = 16 * 1024 * 1024;
+
+} // namespace
+
+struct QueryArena::ThreadBlock {
+    std::unique_ptr<std::byte[]> data;
+    size_t size = 0;
+    bool in_use = false;
+
+    static ThreadBlock* Acquire() {
+        thread_local ThreadBlock block;
+        if (block.in_use) {
+            return nullptr;
+        }
+        if (!block.data) {
+            block.data.reset(new std::byte[INITIAL_BLOCK_SIZE]);
+            block.size = INITIAL_BLOCK_SIZE;
+        }
+        block.in_use = true;
+        return &block;
+    }
+};
+
+QueryArena::QueryArena()
+    : block_(ThreadBlock::Acquire())
+    , overflow_(std::pmr::new_delete_resource())
+    , buffer_(block_ != nullptr ? block_->data.get() : nullptr,
+              block_ != nullptr ? block_->size : 0,
+              &overflow_) {
+}
+
+QueryArena::~QueryArena() {
+    if (block_ == nullptr) {
+        return;
+    }
+    buffer_.release();
+    // запрос не уместился в блок: следующему запросу потока даём блок побольше
+    const size_t overflow_bytes = overflow_.GetAllocatedBytes();
+    if (overflow_bytes > 0 && block_->size < MAX_BLOCK_SIZE) {
+        const size_t new_size = std::min(MAX_BLOCK_SIZE, block_->size + overflow_bytes);
+        block_->data.reset(new std::byte[new_size]);
+        block_->size = new_size;
+    }
+    block_->in_use = false;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+// считает выделения и байты, передавая запросы upstream (потокобезопасен, если безопасен upstream)
+class CountingMemoryResource : public std::pmr::memory_resource {
+public:
+    explicit CountingMemoryResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : upstream_(upstream) {
+    }
+
+    size_t GetAllocationCount() const {
+        return allocation_count_.load(std::memory_order_relaxed);
+    }
+
+    size_t GetAllocatedBytes() const {
+        return allocated_bytes_.load(std::memory_order_relaxed);
+    }
+
+    // байты, выделенные и ещё не освобождённые
+    size_t GetBytesInUse() const {
+        return allocated_bytes_.load(std::memory_order_relaxed) - deallocated_bytes_.load(std::memory_order_relaxed);
+    }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    std::pmr::memory_resource* upstream_;
+    std::atomic<size_t> allocation_count_{0};
+    std::atomic<size_t> allocated_bytes_{0};
+    std::atomic<size_t> deallocated_bytes_{0};
+};
+
+/**
+ * Память для временных структур одного запроса: монотонный буфер
+ * поверх блока текущего потока. Блок переиспользуется следующими
+ * запросами потока и подрастает до наибольшего понадобившегося размера,
+ * поэтому в установившемся режиме запрос не обращается к куче.
+ * Вложенная арена в том же потоке берёт память из кучи.
+ */
+class QueryArena {
+public:
+    QueryArena();
+    ~QueryArena();
+
+    QueryArena(const QueryArena&) = delete;
+    QueryArena& operator=(const QueryArena&) = delete;
+
+    std::pmr::memory_resource* GetResource() {
+        return &buffer_;
+    }
+
+private:
+    struct ThreadBlock;
+
+    ThreadBlock* block_;
+    CountingMemoryResource overflow_;
+    std::pmr::monotonic_buffer_resource buffer_;
+};
@@ -1,8 +1,12 @@
 #pragma once
+#include "search_page.h"
 #include <sstream>
 #include <vector>
 #include <algorithm>
 #include <cassert>
+#include <iterator>
+#include <optional>
+#include <utility>
 
 template <typename Iterator>
 class IteratorRange {
@@ -73,3 +77,99 @@ template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
     return Paginator(begin(c), end(c), page_size);
 }
+
+/**
+ * Постраничный обход результатов, страницы запрашиваются по мере надобности.
+ * source - функция PageRequest -> SearchPage, например
+ *
+ *  auto pages = PaginateLazily([&search_server](const PageRequest& request) {
+ *      return search_server.FindTopDocumentsPage(std::execution::seq, "cat"s, request);
+ *  }, 20);
+ *  const SearchPage page_40 = pages.GetPage(39);
+ *  for (const std::vector<Document>& page : pages) { ... }
+ *
+ * Обход через итераторы продолжает выдачу по курсору предыдущей страницы.
+ */
+template <typename PageSource>
+class LazyPaginator {
+public:
+    class PageIterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::vector<Document>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        PageIterator() = default;
+
+        explicit PageIterator(const LazyPaginator* paginator)
+            : paginator_(paginator) {
+            Fetch(PageRequest{0, paginator_->page_size_, std::nullopt});
+        }
+
+        reference operator*() const {
+            return page_.documents;
+        }
+
+        pointer operator->() const {
+            return &page_.documents;
+        }
+
+        PageIterator& operator++() {
+            if (page_.next_cursor) {
+                Fetch(PageRequest{0, paginator_->page_size_, page_.next_cursor});
+            } else {
+                paginator_ = nullptr;
+            }
+            return *this;
+        }
+
+        bool operator==(const PageIterator& other) const {
+            return paginator_ == nullptr && other.paginator_ == nullptr;
+        }
+
+        bool operator!=(const PageIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        void Fetch(const PageRequest& request) {
+            page_ = paginator_->source_(request);
+            if (page_.documents.empty()) {
+                paginator_ = nullptr;
+            }
+        }
+
+        const LazyPaginator* paginator_ = nullptr;
+        SearchPage page_;
+    };
+
+    LazyPaginator(PageSource source, size_t page_size)
+        : source_(std::move(source))
+        , page_size_(page_size) {
+        assert(page_size > 0);
+    }
+
+    // страница с номером index (с нуля)
+    SearchPage GetPage(size_t index) const {
+        return source_(PageRequest{index * page_size_, page_size_, std::nullopt});
+    }
+
+    PageIterator begin() const {
+        return PageIterator(this);
+    }
+
+    PageIterator end() const {
+        return PageIterator();
+    }
+
+private:
+    PageSource source_;
+    size_t page_size_;
+};
+
+template <typename PageSource>
+auto PaginateLazily(PageSource source, size_t page_size) {
+    return LazyPaginator<PageSource>(std::move(source), page_size);
+}
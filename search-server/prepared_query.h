@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// список документов, содержащих слово: id документа -> TF
+using PostingList = std::pmr::map<int, double>;
+
+// слово запроса, найденное в индексе
+struct ResolvedTerm {
+    std::string_view word;  // указывает на слово из словаря сервера
+    const PostingList* postings = nullptr;
+    double weight = 0.0;    // IDF слова (по формуле политики подсчёта релевантности)
+};
+
+// слово запроса, раскрытое в несколько слов словаря
+// (префикс "слово*" или нечёткое совпадение)
+struct ExpandedTerm {
+    std::vector<ResolvedTerm> expansions;
+    // списки документов раскрытых слов, слитые в один: id -> сумма вкладов слов
+    std::vector<std::pair<int, double>> postings;
+};
+
+struct ResolvedQuery {
+    std::vector<ResolvedTerm> plus_terms;
+    // обязательные слова; они есть и в plus_terms, здесь - только для пересечения списков
+    std::vector<ResolvedTerm> required_terms;
+    // обязательного слова нет в словаре: запросу не подходит ни один документ
+    bool has_unmatched_required_words = false;
+    std::vector<ResolvedTerm> minus_terms;
+    std::vector<ExpandedTerm> expanded_terms;
+    // плюс-слова, которых нет в словаре
+    std::vector<std::string> unmatched_words;
+    // для нормировки BM25 по длине документа
+    double average_document_length = 0.0;
+};
+
+// слова запроса после разбора, отсортированные и без повторов
+template <typename String>
+struct QueryWords {
+    std::vector<String> plus_words;
+    // слова "+слово", которые должны быть в документе; входят и в plus_words
+    std::vector<String> required_words;
+    std::vector<String> minus_words;
+    std::vector<String> plus_prefixes;
+    std::vector<String> minus_prefixes;
+};
+
+/**
+ * Запрос, разобранный один раз с помощью SearchServer::PrepareQuery.
+ * Хранит слова запроса, ссылки на их списки документов и IDF,
+ * поэтому повторные вызовы FindTopDocuments/MatchDocument
+ * не разбирают строку запроса заново.
+ *
+ * Если индекс изменился после подготовки запроса или запрос подготовлен
+ * другим сервером (в том числе оригиналом копии), сервер заново сопоставляет
+ * сохранённые слова со словарём (без повторного разбора строки).
+ */
+class PreparedQuery {
+public:
+    PreparedQuery() = default;
+
+    uint64_t GetIndexVersion() const {
+        return index_version_;
+    }
+
+private:
+    friend class SearchServer;
+
+    QueryWords<std::string> words_;
+    ResolvedQuery resolved_;
+    uint64_t index_version_ = 0;
+    // сервер, чьи списки документов лежат в resolved_
+    uint64_t server_id_ = 0;
+};
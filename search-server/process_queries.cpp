@@ -11,14 +11,7 @@
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server, const std::vector<std::string>& queries) {
 
-    std::vector<std::vector<Document>> query_results(queries.size());
-
-    std::transform(std::execution::par, queries.begin(), queries.end(), query_results.begin(),
-                   [&search_server](std::string query) {
-                    return search_server.FindTopDocuments(query);
-                    }
-    );
-    return query_results;
+    return search_server.FindTopDocumentsBatch(std::execution::par, queries);
 }
 
     std::list<Document> ProcessQueriesJoined(
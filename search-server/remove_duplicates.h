@@ -5,14 +5,14 @@
 
 void RemoveDuplicates(SearchServer& search_server);
 
-template <typename Key, typename Data>
-std::set<Key> ExtractOfKeys (std::map<Key, Data> this_map) ;
+template <typename Key, typename Data, typename Compare, typename Allocator>
+std::set<Key> ExtractOfKeys (const std::map<Key, Data, Compare, Allocator>& this_map) ;
 
 
 
 
-template <typename Key, typename Data>
-std::set<Key> ExtractOfKeys (std::map<Key, Data> this_map) {
+template <typename Key, typename Data, typename Compare, typename Allocator>
+std::set<Key> ExtractOfKeys (const std::map<Key, Data, Compare, Allocator>& this_map) {
     std::set<Key> return_map;
     for (const auto [key, data] : this_map) {
         return_map.insert(key);
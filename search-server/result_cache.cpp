@@ -0,0 +1,116 @@
+#include "result_cache.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+// после стольких запросов на запись частоты уменьшаются вдвое
+const uint64_t AGING_PERIOD_PER_ENTRY = 16;
+
+// кэш делится на части не меньше чем по столько записей, чтобы вытеснение оставалось точным
+const size_t MIN_SHARD_ENTRIES = 16;
+const size_t MAX_SHARD_COUNT = 16;
+
+} // namespace
+
+ResultCacheShard::ResultCacheShard(size_t max_entries, size_t min_query_count)
+    : max_entries_(max_entries)
+    , min_query_count_(min_query_count) {
+}
+
+bool ResultCacheShard::CountQuery(const std::string& key) {
+    if (++counted_queries_ >= AGING_PERIOD_PER_ENTRY * std::max<size_t>(max_entries_, 1)) {
+        counted_queries_ = 0;
+        for (auto it = query_counts_.begin(); it != query_counts_.end();) {
+            it->second /= 2;
+            if (it->second == 0 && entries_.count(it->first) == 0) {
+                it = query_counts_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        RankEntries();
+    }
+
+    uint64_t& count = query_counts_[key];
+    const auto entry = entries_.find(key);
+    if (entry != entries_.end()) {
+        ranked_entries_.erase({count, &entry->first});
+        ++count;
+        ranked_entries_.insert({count, &entry->first});
+        return false;
+    }
+    ++count;
+    if (count < min_query_count_ || max_entries_ == 0) {
+        return false;
+    }
+    return entries_.size() < max_entries_ || ranked_entries_.begin()->first < count;
+}
+
+ResultCacheEntry* ResultCacheShard::Find(const std::string& key) {
+    const auto it = entries_.find(key);
+    return it == entries_.end() ? nullptr : &it->second;
+}
+
+void ResultCacheShard::Insert(const std::string& key, ResultCacheEntry entry) {
+    const auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        it->second = std::move(entry);
+        return;
+    }
+    const uint64_t count = GetQueryCount(key);
+    if (entries_.size() >= max_entries_) {
+        if (ranked_entries_.empty() || ranked_entries_.begin()->first >= count) {
+            return;
+        }
+        const auto rarest = entries_.find(*ranked_entries_.begin()->second);
+        ranked_entries_.erase(ranked_entries_.begin());
+        entries_.erase(rarest);
+    }
+    const auto inserted = entries_.emplace(key, std::move(entry)).first;
+    ranked_entries_.insert({count, &inserted->first});
+    stats_.entries = entries_.size();
+}
+
+uint64_t ResultCacheShard::GetQueryCount(const std::string& key) const {
+    const auto it = query_counts_.find(key);
+    return it == query_counts_.end() ? 0 : it->second;
+}
+
+void ResultCacheShard::RankEntries() {
+    ranked_entries_.clear();
+    for (const auto& [key, _] : entries_) {
+        ranked_entries_.insert({GetQueryCount(key), &key});
+    }
+}
+
+ResultCache::ResultCache(const ResultCacheOptions& options)
+    : options_(options) {
+    const size_t shard_count = std::clamp<size_t>(options_.max_entries / MIN_SHARD_ENTRIES, 1, MAX_SHARD_COUNT);
+    for (size_t i = 0; i < shard_count; ++i) {
+        const size_t max_entries = options_.max_entries / shard_count + (i < options_.max_entries % shard_count ? 1 : 0);
+        shards_.emplace_back(max_entries, options_.min_query_count);
+    }
+}
+
+ResultCache::ResultCache(const ResultCache& other)
+    : ResultCache(other.options_) {
+}
+
+ResultCacheShard& ResultCache::GetShard(std::string_view key) {
+    return shards_[std::hash<std::string_view>{}(key) % shards_.size()];
+}
+
+ResultCacheStats ResultCache::GetStats() const {
+    ResultCacheStats result;
+    for (const ResultCacheShard& shard : shards_) {
+        const auto lock = shard.Lock();
+        const ResultCacheStats& stats = shard.GetStats();
+        result.hits += stats.hits;
+        result.misses += stats.misses;
+        result.builds += stats.builds;
+        result.entries += stats.entries;
+    }
+    return result;
+}
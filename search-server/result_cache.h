@@ -0,0 +1,147 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct ResultCacheOptions {
+    size_t max_entries = 256;
+    // запрос попадает в кэш, когда встретился столько раз
+    size_t min_query_count = 3;
+    // документов в записи: запас сверх MAX_RESULT_DOCUMENT_COUNT
+    // на удаления и на изменение IDF после построения записи
+    size_t candidate_count = 32;
+};
+
+struct ResultCacheStats {
+    uint64_t hits = 0;
+    // подходящие запросы, выполненные обычным поиском
+    uint64_t misses = 0;
+    // записи, построенные или перестроенные полным проходом по спискам документов
+    uint64_t builds = 0;
+    size_t entries = 0;
+};
+
+// документ записи кэша: TF слов записи (0 - слова нет в документе)
+struct ResultCacheCandidate {
+    int document_id = 0;
+    int rating = 0;
+    // релевантность с IDF на момент построения записи
+    double score = 0.0;
+    std::array<double, 2> term_freqs{};
+};
+
+/**
+ * Лучшие ACTUAL-документы запроса из одного-двух плюс-слов.
+ * Документы вне candidates набирали с IDF weights не больше threshold;
+ * is_complete - candidates содержат все документы запроса.
+ */
+struct ResultCacheEntry {
+    std::vector<std::string> words;
+    std::array<double, 2> weights{};
+    // по возрастанию id
+    std::vector<ResultCacheCandidate> candidates;
+    double threshold = 0.0;
+    bool is_complete = true;
+};
+
+/**
+ * Часть кэша результатов: записи и частоты запросов, по которым они выбираются.
+ * Частоты периодически уменьшаются вдвое, чтобы кэш следовал за сменой
+ * популярных запросов. Методы, кроме конструктора, вызываются под Lock().
+ */
+class ResultCacheShard {
+public:
+    ResultCacheShard(size_t max_entries, size_t min_query_count);
+
+    ResultCacheShard(const ResultCacheShard&) = delete;
+    ResultCacheShard& operator=(const ResultCacheShard&) = delete;
+
+    std::unique_lock<std::mutex> Lock() const {
+        return std::unique_lock(mutex_);
+    }
+
+    // учитывает запрос key; true - записи для него нет, и он стал достаточно частым
+    bool CountQuery(const std::string& key);
+
+    ResultCacheEntry* Find(const std::string& key);
+
+    // заменяет запись key; при заполненной части вытесняет самую редкую запись, если она реже key
+    void Insert(const std::string& key, ResultCacheEntry entry);
+
+    std::map<std::string, ResultCacheEntry>& GetEntries() {
+        return entries_;
+    }
+
+    ResultCacheStats& GetStats() {
+        return stats_;
+    }
+
+    const ResultCacheStats& GetStats() const {
+        return stats_;
+    }
+
+private:
+    // частота запроса записи и ключ записи (из узла entries_)
+    using RankedEntry = std::pair<uint64_t, const std::string*>;
+
+    struct RarerEntry {
+        bool operator()(const RankedEntry& lhs, const RankedEntry& rhs) const {
+            return lhs.first != rhs.first ? lhs.first < rhs.first : *lhs.second < *rhs.second;
+        }
+    };
+
+    uint64_t GetQueryCount(const std::string& key) const;
+    // частоты уменьшились вдвое: порядок записей строится заново
+    void RankEntries();
+
+    const size_t max_entries_;
+    const size_t min_query_count_;
+    mutable std::mutex mutex_;
+    std::map<std::string, ResultCacheEntry> entries_;
+    std::map<std::string, uint64_t> query_counts_;
+    // записи по возрастанию частоты: первая - кандидат на вытеснение
+    std::set<RankedEntry, RarerEntry> ranked_entries_;
+    uint64_t counted_queries_ = 0;
+    ResultCacheStats stats_;
+};
+
+/**
+ * Кэш результатов из частей со своими мьютексами. Запрос попадает в часть по хешу
+ * ключа, поэтому учёт частот и выдача из кэша в разных потоках редко ждут друг друга.
+ * max_entries делится между частями, вытеснение и старение частот идут внутри части.
+ */
+class ResultCache {
+public:
+    explicit ResultCache(const ResultCacheOptions& options);
+
+    // пустой кэш с теми же настройками: записи ссылаются на состояние своего индекса
+    ResultCache(const ResultCache& other);
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    const ResultCacheOptions& GetOptions() const {
+        return options_;
+    }
+
+    ResultCacheShard& GetShard(std::string_view key);
+
+    // для обхода всех записей при изменении индекса
+    std::deque<ResultCacheShard>& GetShards() {
+        return shards_;
+    }
+
+    // сумма по частям; берёт их Lock()
+    ResultCacheStats GetStats() const;
+
+private:
+    const ResultCacheOptions options_;
+    // мьютекс не перемещается, поэтому deque
+    std::deque<ResultCacheShard> shards_;
+};
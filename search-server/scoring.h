@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cmath>
+#include <variant>
+
+// релевантность - сумма TF * IDF слов запроса
+struct TfIdfScoring {
+    static double ComputeInverseDocumentFreq(int document_count, double document_freq) {
+        return std::log(document_count * 1.0 / document_freq);
+    }
+};
+
+/**
+ * Okapi BM25: вклад слова растёт с числом его вхождений с насыщением (k1)
+ * и уменьшается для документов длиннее среднего (b от 0 до 1).
+ */
+struct Bm25Scoring {
+    double k1 = 1.2;
+    double b = 0.75;
+
+    static double ComputeInverseDocumentFreq(int document_count, double document_freq) {
+        return std::log(1.0 + (document_count - document_freq + 0.5) / (document_freq + 0.5));
+    }
+};
+
+// способ подсчёта релевантности; по умолчанию TF-IDF
+using ScoringPolicy = std::variant<TfIdfScoring, Bm25Scoring>;
+
+inline double ComputeInverseDocumentFreq(const ScoringPolicy& policy, int document_count, double document_freq) {
+    return std::visit([document_count, document_freq](const auto& scoring) {
+        return scoring.ComputeInverseDocumentFreq(document_count, document_freq);
+    }, policy);
+}
+
+/**
+ * Оценщики вклада слова в релевантность документа для одного запроса:
+ * константы, общие для всех документов, считаются при создании.
+ * Score(TF, длина документа, вес слова); длина - число слов документа без
+ * стоп-слов, нужна, только если USES_DOCUMENT_LENGTH. GetUpperBound - наибольший
+ * вклад слова с данным TF в документ любой длины, не убывает с ростом TF.
+ */
+class TfIdfScorer {
+public:
+    static constexpr bool USES_DOCUMENT_LENGTH = false;
+
+    double Score(double term_freq, int /*document_length*/, double weight) const {
+        return term_freq * weight;
+    }
+
+    double GetUpperBound(double term_freq, double weight) const {
+        return term_freq * weight;
+    }
+};
+
+class Bm25Scorer {
+public:
+    static constexpr bool USES_DOCUMENT_LENGTH = true;
+
+    Bm25Scorer(const Bm25Scoring& scoring, double average_document_length)
+        : saturation_(scoring.k1 + 1.0)
+        , length_base_(scoring.k1 * (1.0 - scoring.b))
+        , length_factor_(scoring.k1 * scoring.b / (average_document_length > 0.0 ? average_document_length : 1.0)) {
+    }
+
+    // TF хранится долей от длины документа; k1 * (1 - b + b * длина / средняя длина)
+    // раскрыто в length_base_ + length_factor_ * длина
+    double Score(double term_freq, int document_length, double weight) const {
+        const double count = term_freq * document_length;
+        return weight * count * saturation_ / (count + length_base_ + length_factor_ * document_length);
+    }
+
+    // Score растёт с длиной документа и стремится к этому пределу
+    double GetUpperBound(double term_freq, double weight) const {
+        return term_freq > 0.0 ? weight * term_freq * saturation_ / (term_freq + length_factor_) : 0.0;
+    }
+
+private:
+    double saturation_;
+    double length_base_;
+    double length_factor_;
+};
+
+inline TfIdfScorer MakeScorer(const TfIdfScoring&, double /*average_document_length*/) {
+    return {};
+}
+
+inline Bm25Scorer MakeScorer(const Bm25Scoring& scoring, double average_document_length) {
+    return {scoring, average_document_length};
+}
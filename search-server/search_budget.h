@@ -0,0 +1,28 @@
+#pragma once
+
+#include "document.h"
+
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+/**
+ * Ограничение одного поиска по индексу влияния (SearchServer::EnableImpactIndex).
+ * Документы просматриваются в порядке убывания вклада TF * IDF, поэтому
+ * при остановке по бюджету лучшие кандидаты, как правило, уже найдены.
+ */
+struct SearchBudget {
+    size_t max_postings = std::numeric_limits<size_t>::max();
+    std::chrono::nanoseconds max_time = std::chrono::nanoseconds::max();
+    // сколько кандидатов после остановки досчитывается точно по спискам документов
+    size_t max_refinements = 64;
+};
+
+struct ApproximateTopDocuments {
+    std::vector<Document> documents;
+    // true - результат доказуемо совпадает с точным поиском
+    bool is_exact = false;
+    size_t postings_processed = 0;
+    size_t postings_total = 0;
+};
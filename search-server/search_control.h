@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+enum class SearchOutcome {
+    COMPLETED,
+    DEADLINE_EXCEEDED,
+    CANCELLED,
+    // очередь AsyncSearchServer заполнена, поиск не выполнялся
+    REJECTED,
+};
+
+/**
+ * Срок и отмена одного поиска. Сервер проверяет их при подсчёте
+ * релевантности раз в CHECK_INTERVAL документов и при остановке
+ * возвращает лучшие документы среди уже оценённых.
+ * Cancel можно вызывать из любого потока.
+ */
+class SearchControl {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static const size_t CHECK_INTERVAL = 256;
+
+    SearchControl() = default;
+
+    explicit SearchControl(Clock::time_point deadline)
+        : deadline_(deadline) {
+    }
+
+    void Cancel() {
+        cancelled_.store(true, std::memory_order_relaxed);
+    }
+
+    // true - поиск нужно прекратить; причина запоминается в GetOutcome
+    bool ShouldStop() const {
+        if (outcome_.load(std::memory_order_relaxed) != SearchOutcome::COMPLETED) {
+            return true;
+        }
+        if (cancelled_.load(std::memory_order_relaxed)) {
+            outcome_.store(SearchOutcome::CANCELLED, std::memory_order_relaxed);
+            return true;
+        }
+        if (deadline_ != Clock::time_point::max() && Clock::now() >= deadline_) {
+            outcome_.store(SearchOutcome::DEADLINE_EXCEEDED, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    // вызывается на каждый просмотренный документ; counter - счётчик вызывающего потока
+    bool Poll(size_t& counter) const {
+        return ++counter % CHECK_INTERVAL == 0 && ShouldStop();
+    }
+
+    SearchOutcome GetOutcome() const {
+        return outcome_.load(std::memory_order_relaxed);
+    }
+
+    Clock::time_point GetDeadline() const {
+        return deadline_;
+    }
+
+private:
+    const Clock::time_point deadline_ = Clock::time_point::max();
+    std::atomic<bool> cancelled_{false};
+    mutable std::atomic<SearchOutcome> outcome_{SearchOutcome::COMPLETED};
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "document.h"
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+// позиция последнего документа страницы; передаётся в следующий запрос без изменений
+struct SearchCursor {
+    double relevance = 0.0;
+    int rating = 0;
+    int document_id = 0;
+};
+
+/**
+ * Запрос страницы результатов: либо пропустить offset лучших документов,
+ * либо (если задан search_after) продолжить сразу после документа курсора.
+ * Сервер упорядочивает только offset + limit лучших документов.
+ */
+struct PageRequest {
+    size_t offset = 0;
+    size_t limit = 20;
+    std::optional<SearchCursor> search_after;
+};
+
+struct SearchPage {
+    std::vector<Document> documents;
+    // число документов, подошедших под запрос (без учёта offset и курсора)
+    size_t matched_documents = 0;
+    // курсор для следующей страницы; пуст, если страница последняя
+    std::optional<SearchCursor> next_cursor;
+};
@@ -7,42 +7,96 @@
 #include <tuple>
 #include <algorithm>
 #include <cmath>
+#include <limits>
 #include <numeric>
 #include <set>
 #include <execution>
+#include <type_traits>
+#include <atomic>
 
-SearchServer::SearchServer(const std::string& stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text)) {
+namespace {
+
+// 0 - запрос, не подготовленный ни одним сервером
+std::atomic<uint64_t> next_instance_id{1};
+
+// отмечает marks[i * stride] для каждого ids[i] из [first, last), который есть в postings;
+// ids отсортированы по возрастанию
+void MarkPostingMatches(const PostingList& postings, const std::vector<int>& ids,
+                        size_t first, size_t last, char* marks, size_t stride) {
+    const size_t batch_size = last - first;
+    if (batch_size == 0 || postings.empty()) {
+        return;
+    }
+
+    // маленькую пачку дешевле искать в дереве по одному id,
+    // большую - пройти слиянием по списку документов слова
+    if (batch_size * std::log2(postings.size() + 1.0) < postings.size()) {
+        for (size_t i = first; i < last; ++i) {
+            if (postings.count(ids[i])) {
+                marks[i * stride] = 1;
+            }
+        }
+        return;
+    }
+
+    auto it = postings.lower_bound(ids[first]);
+    size_t i = first;
+    while (i < last && it != postings.end()) {
+        if (it->first < ids[i]) {
+            ++it;
+        } else if (ids[i] < it->first) {
+            ++i;
+        } else {
+            marks[i * stride] = 1;
+            ++it;
+            ++i;
+        }
+    }
 }
 
-SearchServer::SearchServer(const std::string_view stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text)) {
+} // namespace
+
+SearchServer::SearchServer(const std::string& stop_words_text, std::pmr::memory_resource* index_resource)
+    : SearchServer(SplitIntoWords(stop_words_text), index_resource) {
+}
+
+SearchServer::SearchServer(const std::string_view stop_words_text, std::pmr::memory_resource* index_resource)
+    : SearchServer(SplitIntoWords(stop_words_text), index_resource) {
 }
 
 void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
     if ((document_id < 0) || (documents_.count(document_id) > 0)) {
         throw std::invalid_argument("Invalid document_id");
     }
-    const auto words = SplitIntoWordsNoStop(document);
+    std::string normalized_document;
+    const auto words = SplitIntoWordsNoStop(document, normalized_document);
 
     const double inv_word_count = 1.0 / words.size();
     for (const std::string_view word : words) {
-        auto it = words_.insert(std::string(word));
-        std::string_view view_word = *(it.first);
+        auto it = words_.find(word);
+        if (it == words_.end()) {
+            it = words_.emplace(word).first;
+        }
+        std::string_view view_word = *it;
 
         word_to_document_freqs_[view_word][document_id] += inv_word_count;
         document_ids_with_word_[document_id][view_word] += inv_word_count;
     }
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
+    if (has_impact_index_) {
+        for (const auto& [word, term_freq] : document_ids_with_word_[document_id]) {
+            word_to_impacts_[word].emplace(term_freq, document_id);
+        }
+    }
+    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status, static_cast<int>(words.size())});
+    total_word_count_ += static_cast<int64_t>(words.size());
     document_ids_.insert(document_id);
+    ++index_version_;
+    AddToResultCache(document_id);
 }
 
 std::vector<Document>
 SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(raw_query,
-           [status](int document_id, DocumentStatus document_status,int rating) {
-                        return document_status == status;
-                    });
+    return FindTopDocuments(std::execution::seq, raw_query, status);
 }
 
 std::vector<Document>
@@ -51,69 +105,827 @@ SearchServer::FindTopDocuments(
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+ApproximateTopDocuments
+SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status, const SearchBudget& budget) const {
+    return FindTopDocuments(raw_query,
+           [status](int document_id, DocumentStatus document_status, int rating) {
+                        return document_status == status;
+                    }, budget);
+}
+
+ApproximateTopDocuments
+SearchServer::FindTopDocuments(const std::string_view raw_query, const SearchBudget& budget) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL, budget);
+}
+
+TermStatistics SearchServer::GetTermStatistics(std::string_view raw_query) const {
+    const ResolvedQuery query = ResolveQuery(ParseQuery(std::execution::seq, raw_query));
+    TermStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+    statistics.word_count = total_word_count_;
+    for (const ResolvedTerm& term : GetScoringTerms(query)) {
+        statistics.document_freqs[std::string(term.word)] = static_cast<int>(term.postings->size());
+    }
+    return statistics;
+}
+
+void SearchServer::ApplyTermStatistics(ResolvedQuery& query, const TermStatistics& statistics) const {
+    const auto apply = [this, &statistics](ResolvedTerm& term) {
+        const auto it = statistics.document_freqs.find(term.word);
+        if (it != statistics.document_freqs.end() && it->second > 0) {
+            term.weight = ComputeInverseDocumentFreq(scoring_policy_, statistics.document_count, it->second);
+        }
+    };
+    if (statistics.document_count > 0) {
+        query.average_document_length = statistics.word_count * 1.0 / statistics.document_count;
+    }
+    std::for_each(query.plus_terms.begin(), query.plus_terms.end(), apply);
+    for (ExpandedTerm& term : query.expanded_terms) {
+        std::for_each(term.expansions.begin(), term.expansions.end(), apply);
+        term.postings = MergePostings(term.expansions, query.average_document_length);
+    }
+}
+
+uint64_t SearchServer::InstanceId::Next() {
+    return next_instance_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<Document>
+SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentStatus status) const {
+    return FindTopDocuments(std::execution::seq, query, status);
+}
+
+std::vector<Document>
+SearchServer::FindTopDocuments(const PreparedQuery& query) const {
+    return FindTopDocuments(query, DocumentStatus::ACTUAL);
+}
+
+PreparedQuery SearchServer::PrepareQuery(std::string_view raw_query) const {
+    const auto query = ParseQuery(std::execution::seq, raw_query);
+
+    PreparedQuery result;
+    result.words_.plus_words.assign(query.plus_words.begin(), query.plus_words.end());
+    result.words_.required_words.assign(query.required_words.begin(), query.required_words.end());
+    result.words_.minus_words.assign(query.minus_words.begin(), query.minus_words.end());
+    result.words_.plus_prefixes.assign(query.plus_prefixes.begin(), query.plus_prefixes.end());
+    result.words_.minus_prefixes.assign(query.minus_prefixes.begin(), query.minus_prefixes.end());
+    result.resolved_ = ResolveQuery(query);
+    result.index_version_ = index_version_;
+    result.server_id_ = instance_id_.Get();
+    return result;
+}
+
+void SearchServer::RefreshQuery(PreparedQuery& query) const {
+    if (IsResolvedByThisServer(query)) {
+        return;
+    }
+    query.resolved_ = ResolveQuery(query.words_);
+    query.index_version_ = index_version_;
+    query.server_id_ = instance_id_.Get();
+}
+
+bool SearchServer::IsResolvedByThisServer(const PreparedQuery& query) const {
+    return query.server_id_ == instance_id_.Get() && query.index_version_ == index_version_;
+}
+
+const ResolvedQuery& SearchServer::GetResolvedQuery(const PreparedQuery& query, ResolvedQuery& scratch) const {
+    if (IsResolvedByThisServer(query)) {
+        return query.resolved_;
+    }
+    scratch = ResolveQuery(query.words_);
+    return scratch;
+}
+
+std::vector<ResolvedTerm> SearchServer::ExpandPrefix(std::string_view prefix, size_t limit) const {
+    // слова с общим префиксом идут в словаре подряд
+    std::vector<ResolvedTerm> terms;
+    for (auto it = word_to_document_freqs_.lower_bound(prefix);
+         it != word_to_document_freqs_.end() && it->first.substr(0, prefix.size()) == prefix;
+         ++it) {
+        if (!it->second.empty()) {
+            terms.push_back({it->first, &it->second, 0.0});
+        }
+    }
+    // остаются слова из наибольшего числа документов, при равенстве - первые по алфавиту
+    if (terms.size() > limit) {
+        std::stable_sort(terms.begin(), terms.end(), [](const ResolvedTerm& lhs, const ResolvedTerm& rhs) {
+            return lhs.postings->size() > rhs.postings->size();
+        });
+        terms.resize(limit);
+        std::sort(terms.begin(), terms.end(), [](const ResolvedTerm& lhs, const ResolvedTerm& rhs) {
+            return lhs.word < rhs.word;
+        });
+    }
+    for (ResolvedTerm& term : terms) {
+        term.weight = ComputeWordInverseDocumentFreq(term.word);
+    }
+    return terms;
+}
+
+std::vector<ResolvedTerm> SearchServer::ExpandFuzzy(std::string_view word, int max_distance,
+                                                   std::chrono::steady_clock::time_point deadline) const {
+    const LevenshteinAutomaton automaton(word, max_distance);
+    // states[i] - состояние автомата после первых i символов текущего слова словаря;
+    // у соседних слов словаря общий префикс, и его состояния не пересчитываются
+    std::vector<LevenshteinAutomaton::State> states{automaton.Start()};
+    size_t valid_states = 1;
+    std::string_view previous;
+
+    using WordIterator = decltype(word_to_document_freqs_)::const_iterator;
+    std::vector<std::pair<int, WordIterator>> candidates;
+    size_t steps = 0;
+    auto it = word_to_document_freqs_.begin();
+    while (it != word_to_document_freqs_.end()) {
+        if (++steps % 256 == 0 && std::chrono::steady_clock::now() > deadline) {
+            break;
+        }
+        const std::string_view term = it->first;
+        const auto [previous_end, term_end] = std::mismatch(previous.begin(), previous.end(), term.begin(), term.end());
+        size_t depth = std::min<size_t>(term_end - term.begin(), valid_states - 1);
+        previous = term;
+
+        bool is_dead = false;
+        while (depth < term.size()) {
+            if (states.size() <= depth + 1) {
+                states.emplace_back();
+            }
+            automaton.Step(states[depth], term[depth], states[depth + 1]);
+            ++depth;
+            if (!automaton.CanMatch(states[depth])) {
+                is_dead = true;
+                break;
+            }
+        }
+        valid_states = depth + 1;
+
+        if (is_dead) {
+            // ни одно слово с префиксом term[0, depth) не подходит: переходим к следующему префиксу
+            std::string next_prefix(term.substr(0, depth));
+            while (!next_prefix.empty() && next_prefix.back() == '\xFF') {
+                next_prefix.pop_back();
+            }
+            if (next_prefix.empty()) {
+                break;
+            }
+            ++next_prefix.back();
+            it = word_to_document_freqs_.lower_bound(next_prefix);
+            continue;
+        }
+
+        const int distance = automaton.GetDistance(states[depth]);
+        if (automaton.IsMatch(states[depth]) && distance > 0 && !it->second.empty()) {
+            candidates.emplace_back(distance, it);
+        }
+        ++it;
+    }
+
+    // ближайшие слова, при равном расстоянии - более частые
+    const size_t count = std::min(candidates.size(), fuzzy_options_->max_expansions);
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+                      [](const auto& lhs, const auto& rhs) {
+                          return std::make_pair(lhs.first, rhs.second->second.size())
+                              < std::make_pair(rhs.first, lhs.second->second.size());
+                      });
+
+    std::vector<ResolvedTerm> terms;
+    terms.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const auto [distance, word_it] = candidates[i];
+        const double penalty = std::pow(fuzzy_options_->distance_penalty, distance);
+        terms.push_back({word_it->first, &word_it->second, ComputeWordInverseDocumentFreq(word_it->first) * penalty});
+    }
+    return terms;
+}
+
+ResolvedQuery SearchServer::ResolveFuzzy(const ResolvedQuery& query) const {
+    const FuzzyMatchOptions& options = *fuzzy_options_;
+    const auto deadline = std::chrono::steady_clock::now() + options.time_budget;
+
+    ResolvedQuery result = query;
+    for (const std::string_view word : query.unmatched_words) {
+        if (word.size() < options.min_word_length) {
+            continue;
+        }
+        const int max_distance = word.size() < options.min_word_length_for_two_edits
+            ? std::min(options.max_distance, 1)
+            : options.max_distance;
+        ExpandedTerm term;
+        term.expansions = ExpandFuzzy(word, max_distance, deadline);
+        if (!term.expansions.empty()) {
+            term.postings = MergePostings(term.expansions, result.average_document_length);
+            result.expanded_terms.push_back(std::move(term));
+        }
+    }
+    return result;
+}
+
+std::vector<std::pair<int, double>> SearchServer::MergePostings(const std::vector<ResolvedTerm>& terms,
+                                                                double average_document_length) const {
+    return VisitScorer(average_document_length, [this, &terms](const auto& scorer) {
+        return MergeScoredPostings(terms, scorer);
+    });
+}
+
+template <typename Scorer>
+std::vector<std::pair<int, double>> SearchServer::MergeScoredPostings(const std::vector<ResolvedTerm>& terms,
+                                                                      const Scorer& scorer) const {
+    struct Cursor {
+        PostingList::const_iterator it;
+        PostingList::const_iterator end;
+        double weight;
+    };
+    // куча с наименьшим id документа наверху
+    const auto cursor_greater = [](const Cursor& lhs, const Cursor& rhs) {
+        return lhs.it->first > rhs.it->first;
+    };
+
+    std::vector<Cursor> heap;
+    heap.reserve(terms.size());
+    size_t total_size = 0;
+    for (const ResolvedTerm& term : terms) {
+        if (!term.postings->empty()) {
+            heap.push_back({term.postings->begin(), term.postings->end(), term.weight});
+            total_size += term.postings->size();
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), cursor_greater);
+
+    std::vector<std::pair<int, double>> postings;
+    postings.reserve(total_size);
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), cursor_greater);
+        Cursor& cursor = heap.back();
+        const auto [document_id, term_freq] = *cursor.it;
+        int document_length = 0;
+        if constexpr (Scorer::USES_DOCUMENT_LENGTH) {
+            document_length = documents_.at(document_id).word_count;
+        }
+        const double contribution = scorer.Score(term_freq, document_length, cursor.weight);
+        if (!postings.empty() && postings.back().first == document_id) {
+            postings.back().second += contribution;
+        } else {
+            postings.emplace_back(document_id, contribution);
+        }
+        if (++cursor.it == cursor.end) {
+            heap.pop_back();
+        } else {
+            std::push_heap(heap.begin(), heap.end(), cursor_greater);
+        }
+    }
+    return postings;
+}
+
+const std::vector<ResolvedTerm>& SearchServer::GetMatchTerms(const ResolvedQuery& query, std::vector<ResolvedTerm>& scratch) {
+    if (query.expanded_terms.empty()) {
+        return query.plus_terms;
+    }
+    scratch = query.plus_terms;
+    for (const ExpandedTerm& prefix : query.expanded_terms) {
+        scratch.insert(scratch.end(), prefix.expansions.begin(), prefix.expansions.end());
+    }
+    const auto word_less = [](const ResolvedTerm& lhs, const ResolvedTerm& rhs) {
+        return lhs.word < rhs.word;
+    };
+    const auto word_equal = [](const ResolvedTerm& lhs, const ResolvedTerm& rhs) {
+        return lhs.word == rhs.word;
+    };
+    std::sort(scratch.begin(), scratch.end(), word_less);
+    scratch.erase(std::unique(scratch.begin(), scratch.end(), word_equal), scratch.end());
+    return scratch;
+}
+
 int SearchServer::GetDocumentCount() const {
     return SearchServer::documents_.size();
 }
 
+uint64_t SearchServer::GetIndexVersion() const {
+    return index_version_;
+}
+
+void SearchServer::SetPrefixExpansionLimit(size_t limit) {
+    prefix_expansion_limit_ = limit;
+    // подготовленные запросы раскрыли префиксы с прежним ограничением
+    ++index_version_;
+}
+
+void SearchServer::EnableFuzzyMatching(const FuzzyMatchOptions& options) {
+    fuzzy_options_ = options;
+}
+
+void SearchServer::DisableFuzzyMatching() {
+    fuzzy_options_.reset();
+}
+
+void SearchServer::EnableImpactIndex() {
+    if (has_impact_index_) {
+        return;
+    }
+    for (const auto& [word, postings] : word_to_document_freqs_) {
+        ImpactList& impacts = word_to_impacts_[word];
+        for (const auto [document_id, term_freq] : postings) {
+            impacts.emplace(term_freq, document_id);
+        }
+    }
+    has_impact_index_ = true;
+}
+
+void SearchServer::DisableImpactIndex() {
+    word_to_impacts_.clear();
+    has_impact_index_ = false;
+}
+
+void SearchServer::SetScoringPolicy(const ScoringPolicy& scoring_policy) {
+    scoring_policy_ = scoring_policy;
+    // IDF подготовленных запросов и записи кэша посчитаны по прежней политике
+    ++index_version_;
+    if (result_cache_) {
+        result_cache_.emplace(result_cache_->GetOptions());
+    }
+}
+
+const ScoringPolicy& SearchServer::GetScoringPolicy() const {
+    return scoring_policy_;
+}
+
+void SearchServer::EnableResultCache(const ResultCacheOptions& options) {
+    result_cache_.emplace(options);
+}
+
+void SearchServer::DisableResultCache() {
+    result_cache_.reset();
+}
+
+ResultCacheStats SearchServer::GetResultCacheStats() const {
+    if (!result_cache_) {
+        return {};
+    }
+    return result_cache_->GetStats();
+}
+
+void SearchServer::EnableTextNormalization(const TextNormalizerOptions& options) {
+    // слова документов в индексе разобраны без нормализации
+    if (!documents_.empty()) {
+        throw std::logic_error("Text normalization must be enabled before adding documents");
+    }
+    text_normalizer_.emplace(options);
+    std::set<std::string, std::less<>> stop_words;
+    std::string storage;
+    for (const std::string& stop_word : stop_words_) {
+        for (const std::string_view word : text_normalizer_->Split(stop_word, storage)) {
+            stop_words.emplace(word);
+        }
+    }
+    stop_words_ = std::move(stop_words);
+    ++index_version_;
+}
+
+std::optional<std::vector<Document>> SearchServer::FindCachedTopDocuments(const Query& query) const {
+    if (!std::holds_alternative<TfIdfScoring>(scoring_policy_)
+        || query.plus_words.empty() || query.plus_words.size() > 2 || !query.minus_words.empty()
+        || !query.required_words.empty()
+        || !query.plus_prefixes.empty() || !query.minus_prefixes.empty()) {
+        return std::nullopt;
+    }
+    // слово не из словаря - обычный поиск, возможно, с исправлением опечаток
+    std::vector<std::string> unmatched_words;
+    const std::vector<ResolvedTerm> terms = ResolveTerms(query.plus_words, &unmatched_words);
+    if (!unmatched_words.empty()) {
+        return std::nullopt;
+    }
+    std::string key(terms[0].word);
+    if (terms.size() > 1) {
+        key += ' ';
+        key += terms[1].word;
+    }
+
+    ResultCacheShard& shard = result_cache_->GetShard(key);
+    auto lock = shard.Lock();
+    ResultCacheStats& stats = shard.GetStats();
+    const bool should_build = shard.CountQuery(key);
+    const ResultCacheEntry* entry = shard.Find(key);
+    if (entry == nullptr && !should_build) {
+        ++stats.misses;
+        return std::nullopt;
+    }
+    if (entry != nullptr) {
+        if (auto documents = ServeResultCacheEntry(*entry, terms)) {
+            ++stats.hits;
+            return documents;
+        }
+    }
+    lock.unlock();
+
+    // записи нет, или удаления и изменение IDF не дают доказать выдачу - полный проход;
+    // он идёт без блокировки, чтобы не задерживать другие запросы части кэша
+    const uint64_t index_version = index_version_;
+    ResultCacheEntry built = BuildResultCacheEntry(terms);
+    std::optional<std::vector<Document>> documents = ServeResultCacheEntry(built, terms);
+
+    lock.lock();
+    ++stats.builds;
+    ++(documents ? stats.hits : stats.misses);
+    // запись, построенная по изменившемуся индексу, пропустила бы его изменения в кэше
+    if (index_version == index_version_) {
+        shard.Insert(key, std::move(built));
+    }
+    return documents;
+}
+
+ResultCacheEntry SearchServer::BuildResultCacheEntry(const std::vector<ResolvedTerm>& terms) const {
+    ResultCacheEntry entry;
+    std::map<int, ResultCacheCandidate> candidates;
+    for (size_t i = 0; i < terms.size(); ++i) {
+        entry.words.emplace_back(terms[i].word);
+        entry.weights[i] = terms[i].weight;
+        for (const auto [document_id, term_freq] : *terms[i].postings) {
+            const DocumentData& document_data = documents_.at(document_id);
+            if (document_data.status != DocumentStatus::ACTUAL) {
+                continue;
+            }
+            ResultCacheCandidate& candidate = candidates[document_id];
+            candidate.document_id = document_id;
+            candidate.rating = document_data.rating;
+            candidate.term_freqs[i] = term_freq;
+            // в том же порядке, что и FindAllDocuments
+            candidate.score += term_freq * terms[i].weight;
+        }
+    }
+
+    for (const auto& [_, candidate] : candidates) {
+        entry.candidates.push_back(candidate);
+    }
+    const size_t candidate_count = result_cache_->GetOptions().candidate_count;
+    if (entry.candidates.size() > candidate_count) {
+        std::nth_element(entry.candidates.begin(), entry.candidates.begin() + candidate_count, entry.candidates.end(),
+                         [](const ResultCacheCandidate& lhs, const ResultCacheCandidate& rhs) {
+                             return lhs.score > rhs.score;
+                         });
+        entry.threshold = entry.candidates[candidate_count].score;
+        entry.is_complete = false;
+        entry.candidates.resize(candidate_count);
+        std::sort(entry.candidates.begin(), entry.candidates.end(),
+                  [](const ResultCacheCandidate& lhs, const ResultCacheCandidate& rhs) {
+                      return lhs.document_id < rhs.document_id;
+                  });
+    }
+    return entry;
+}
+
+std::optional<std::vector<Document>> SearchServer::ServeResultCacheEntry(const ResultCacheEntry& entry,
+                                                                         const std::vector<ResolvedTerm>& terms) const {
+    // документ вне записи набирал не больше threshold, TF не больше 1,
+    // поэтому с нынешними IDF он наберёт не больше bound
+    double bound = entry.threshold;
+    for (size_t i = 0; i < terms.size(); ++i) {
+        bound += std::max(0.0, terms[i].weight - entry.weights[i]);
+    }
+
+    std::vector<Document> documents;
+    documents.reserve(entry.candidates.size());
+    for (const ResultCacheCandidate& candidate : entry.candidates) {
+        double relevance = 0.0;
+        for (size_t i = 0; i < terms.size(); ++i) {
+            if (candidate.term_freqs[i] > 0.0) {
+                relevance += candidate.term_freqs[i] * terms[i].weight;
+            }
+        }
+        documents.push_back({candidate.document_id, relevance, candidate.rating});
+    }
+    SelectTopDocuments(std::execution::seq, documents, MAX_RESULT_DOCUMENT_COUNT);
+
+    if (entry.is_complete) {
+        return documents;
+    }
+    if (documents.size() < static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT)) {
+        return std::nullopt;
+    }
+    for (const Document& document : documents) {
+        if (document.relevance - bound < EPSILON) {
+            return std::nullopt;
+        }
+    }
+    return documents;
+}
+
+void SearchServer::AddToResultCache(int document_id) {
+    if (!result_cache_ || !std::holds_alternative<TfIdfScoring>(scoring_policy_)
+        || documents_.at(document_id).status != DocumentStatus::ACTUAL) {
+        return;
+    }
+    const WordFrequencies& word_freqs = document_ids_with_word_.at(document_id);
+    const size_t candidate_count = result_cache_->GetOptions().candidate_count;
+    for (ResultCacheShard& shard : result_cache_->GetShards()) {
+        const auto lock = shard.Lock();
+        for (auto& [_, entry] : shard.GetEntries()) {
+            ResultCacheCandidate candidate;
+            candidate.document_id = document_id;
+            candidate.rating = documents_.at(document_id).rating;
+            bool has_words = false;
+            for (size_t i = 0; i < entry.words.size(); ++i) {
+                const auto it = word_freqs.find(entry.words[i]);
+                if (it != word_freqs.end()) {
+                    candidate.term_freqs[i] = it->second;
+                    candidate.score += it->second * entry.weights[i];
+                    has_words = true;
+                }
+            }
+            // документ слабее границы записи не меняет её выдачу
+            if (!has_words || (!entry.is_complete && candidate.score <= entry.threshold)) {
+                continue;
+            }
+            entry.candidates.insert(std::lower_bound(entry.candidates.begin(), entry.candidates.end(), document_id,
+                                                     [](const ResultCacheCandidate& lhs, int id) {
+                                                         return lhs.document_id < id;
+                                                     }),
+                                    candidate);
+            if (entry.candidates.size() > candidate_count) {
+                const auto weakest = std::min_element(entry.candidates.begin(), entry.candidates.end(),
+                                                      [](const ResultCacheCandidate& lhs, const ResultCacheCandidate& rhs) {
+                                                          return lhs.score < rhs.score;
+                                                      });
+                entry.threshold = entry.is_complete ? weakest->score : std::max(entry.threshold, weakest->score);
+                entry.is_complete = false;
+                entry.candidates.erase(weakest);
+            }
+        }
+    }
+}
+
+void SearchServer::RemoveFromResultCache(int document_id) {
+    if (!result_cache_) {
+        return;
+    }
+    for (ResultCacheShard& shard : result_cache_->GetShards()) {
+        const auto lock = shard.Lock();
+        for (auto& [_, entry] : shard.GetEntries()) {
+            const auto it = std::lower_bound(entry.candidates.begin(), entry.candidates.end(), document_id,
+                                             [](const ResultCacheCandidate& lhs, int id) {
+                                                 return lhs.document_id < id;
+                                             });
+            // если кандидатов станет меньше MAX_RESULT_DOCUMENT_COUNT, запись перестроится при поиске
+            if (it != entry.candidates.end() && it->document_id == document_id) {
+                entry.candidates.erase(it);
+            }
+        }
+    }
+}
+
+std::vector<ResolvedTerm> SearchServer::GetScoringTerms(const ResolvedQuery& query) {
+    std::vector<ResolvedTerm> terms = query.plus_terms;
+    for (const ExpandedTerm& term : query.expanded_terms) {
+        terms.insert(terms.end(), term.expansions.begin(), term.expansions.end());
+    }
+    return terms;
+}
+
+void SearchServer::RefineTopDocuments(const ResolvedQuery& query, const std::vector<ResolvedTerm>& terms,
+                                      const std::pmr::map<int, double>& partial_relevance, double remaining_bound,
+                                      size_t max_refinements, ApproximateTopDocuments& result) const {
+    // частичная релевантность - нижняя граница, частичная + remaining_bound - верхняя
+    std::vector<std::pair<int, double>> candidates(partial_relevance.begin(), partial_relevance.end());
+    const size_t refine_count = std::min(candidates.size(), max_refinements);
+    std::partial_sort(candidates.begin(), candidates.begin() + refine_count, candidates.end(),
+                      [](const auto& lhs, const auto& rhs) {
+                          return lhs.second > rhs.second;
+                      });
+
+    const auto has_minus_word = [&query](int document_id) {
+        return std::any_of(query.minus_terms.begin(), query.minus_terms.end(), [document_id](const ResolvedTerm& term) {
+            return term.postings->count(document_id) > 0;
+        });
+    };
+    const auto kth_relevance = [&result]() {
+        return result.documents.size() < MAX_RESULT_DOCUMENT_COUNT
+            ? 0.0
+            : result.documents.back().relevance;
+    };
+
+    bool is_proven = false;
+    size_t refined = 0;
+    VisitScorer(query.average_document_length, [&](const auto& scorer) {
+        for (; refined < refine_count; ++refined) {
+            const auto [document_id, relevance] = candidates[refined];
+            if (result.documents.size() == MAX_RESULT_DOCUMENT_COUNT
+                && relevance + remaining_bound < kth_relevance() - EPSILON) {
+                is_proven = true;
+                break;
+            }
+            if (has_minus_word(document_id)) {
+                continue;
+            }
+
+            const DocumentData& document_data = documents_.at(document_id);
+            double exact_relevance = 0.0;
+            for (const ResolvedTerm& term : terms) {
+                const auto it = term.postings->find(document_id);
+                if (it != term.postings->end()) {
+                    exact_relevance += scorer.Score(it->second, document_data.word_count, term.weight);
+                }
+            }
+            result.documents.push_back({document_id, exact_relevance, document_data.rating});
+            SelectTopDocuments(std::execution::seq, result.documents, MAX_RESULT_DOCUMENT_COUNT);
+        }
+    });
+
+    if (!is_proven) {
+        // недосчитанные кандидаты не лучше последнего досчитанного
+        const double unrefined_bound = refined > 0 && refined < candidates.size()
+            ? candidates[refined - 1].second + remaining_bound
+            : 0.0;
+        is_proven = result.documents.size() == MAX_RESULT_DOCUMENT_COUNT
+            && unrefined_bound < kth_relevance() - EPSILON;
+    }
+    // документ, ещё не встреченный ни в одном списке, наберёт не больше remaining_bound
+    result.is_exact = is_proven && remaining_bound < kth_relevance() - EPSILON;
+}
+
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
     return MatchDocument(std::execution::seq, raw_query, document_id);
 }
 
-
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::sequenced_policy&, std::string_view raw_query, int document_id) const {
     const auto query = ParseQuery(std::execution::seq, raw_query);
+    return MatchResolved(std::execution::seq, ResolveQuery(query), document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const {
+    const auto query = ParseQuery(std::execution::par, raw_query, true);
+    return MatchResolved(std::execution::par, ResolveQuery(query), document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const PreparedQuery& query, int document_id) const {
+    return MatchDocument(std::execution::seq, query, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::sequenced_policy&, const PreparedQuery& query, int document_id) const {
+    ResolvedQuery scratch;
+    return MatchResolved(std::execution::seq, GetResolvedQuery(query, scratch), document_id);
+}
 
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy&, const PreparedQuery& query, int document_id) const {
+    ResolvedQuery scratch;
+    return MatchResolved(std::execution::par, GetResolvedQuery(query, scratch), document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchResolved(const std::execution::sequenced_policy&, const ResolvedQuery& query, int document_id) const {
     const auto status = documents_.at(document_id).status;
 
-    for (const std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(std::string(word)) == 0) {
-            continue;
+    for (const ResolvedTerm& term : query.minus_terms) {
+        if (term.postings->count(document_id)) {
+            return {std::vector<std::string_view>{}, status};
         }
-        if (word_to_document_freqs_.at(std::string(word)).count(document_id)) {
-            return {{}, status};
+    }
+    if (query.has_unmatched_required_words) {
+        return {std::vector<std::string_view>{}, status};
+    }
+    for (const ResolvedTerm& term : query.required_terms) {
+        if (!term.postings->count(document_id)) {
+            return {std::vector<std::string_view>{}, status};
         }
     }
 
+    std::vector<ResolvedTerm> match_scratch;
     std::vector<std::string_view> matched_words;
-    for (const std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(std::string(word)) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(std::string(word)).count(document_id)) {
-            matched_words.push_back(word);
+    for (const ResolvedTerm& term : GetMatchTerms(query, match_scratch)) {
+        if (term.postings->count(document_id)) {
+            matched_words.push_back(term.word);
         }
     }
     return {matched_words, status};
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const {
-    const auto query = ParseQuery(std::execution::par, raw_query, true);
-
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchResolved(const std::execution::parallel_policy&, const ResolvedQuery& query, int document_id) const {
     const auto status = documents_.at(document_id).status;
 
-    const auto word_checker =
-        [this, document_id](const std::string_view word) {
-            const auto it = word_to_document_freqs_.find(std::string(word));
-            return it != word_to_document_freqs_.end() && it->second.count(document_id);
+    const auto term_checker =
+        [document_id](const ResolvedTerm& term) {
+            return term.postings->count(document_id) > 0;
         };
-    if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), word_checker)) {
-        return {{}, status};
+    if (std::any_of(std::execution::par, query.minus_terms.begin(), query.minus_terms.end(), term_checker)
+        || query.has_unmatched_required_words
+        || !std::all_of(std::execution::par, query.required_terms.begin(), query.required_terms.end(), term_checker)) {
+        return {std::vector<std::string_view>{}, status};
     }
 
-    std::vector<std::string_view> matched_words(query.plus_words.size());
-    auto words_end = std::copy_if(
+    std::vector<ResolvedTerm> match_scratch;
+    const std::vector<ResolvedTerm>& match_terms = GetMatchTerms(query, match_scratch);
+    std::vector<ResolvedTerm> matched_terms(match_terms.size());
+    const auto terms_end = std::copy_if(
         std::execution::par,
-        query.plus_words.begin(), query.plus_words.end(),
-        matched_words.begin(),
-        word_checker
+        match_terms.begin(), match_terms.end(),
+        matched_terms.begin(),
+        term_checker
     );
-    std::sort(std::execution::par, matched_words.begin(), words_end);
-    words_end = std::unique(matched_words.begin(), words_end);
-    matched_words.erase(words_end, matched_words.end());
+
+    std::vector<std::string_view> matched_words(std::distance(matched_terms.begin(), terms_end));
+    std::transform(matched_terms.begin(), terms_end, matched_words.begin(),
+                   [](const ResolvedTerm& term) {
+                       return term.word;
+                   });
 
     return {matched_words, status};
+}
+
+MatchedDocuments SearchServer::MatchDocuments(std::string_view raw_query, const std::vector<int>& document_ids) const {
+    return MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
 
+MatchedDocuments SearchServer::MatchDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, const std::vector<int>& document_ids) const {
+    const auto query = ParseQuery(std::execution::seq, raw_query);
+    return MatchResolvedBatch(std::execution::seq, ResolveQuery(query), document_ids);
+}
 
+MatchedDocuments SearchServer::MatchDocuments(const std::execution::parallel_policy&, std::string_view raw_query, const std::vector<int>& document_ids) const {
+    const auto query = ParseQuery(std::execution::par, raw_query);
+    return MatchResolvedBatch(std::execution::par, ResolveQuery(query), document_ids);
+}
+
+MatchedDocuments SearchServer::MatchDocuments(const PreparedQuery& query, const std::vector<int>& document_ids) const {
+    return MatchDocuments(std::execution::seq, query, document_ids);
+}
+
+MatchedDocuments SearchServer::MatchDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query, const std::vector<int>& document_ids) const {
+    ResolvedQuery scratch;
+    return MatchResolvedBatch(std::execution::seq, GetResolvedQuery(query, scratch), document_ids);
+}
+
+MatchedDocuments SearchServer::MatchDocuments(const std::execution::parallel_policy&, const PreparedQuery& query, const std::vector<int>& document_ids) const {
+    ResolvedQuery scratch;
+    return MatchResolvedBatch(std::execution::par, GetResolvedQuery(query, scratch), document_ids);
+}
+
+template <typename ExecutionPolicy>
+MatchedDocuments SearchServer::MatchResolvedBatch(const ExecutionPolicy& policy, const ResolvedQuery& query, const std::vector<int>& document_ids) const {
+    MatchedDocuments result;
+    result.document_ids = document_ids;
+    std::sort(result.document_ids.begin(), result.document_ids.end());
+    result.document_ids.erase(std::unique(result.document_ids.begin(), result.document_ids.end()),
+                              result.document_ids.end());
+
+    const std::vector<int>& ids = result.document_ids;
+    const size_t batch_size = ids.size();
+    result.statuses.reserve(batch_size);
+    for (const int document_id : ids) {
+        result.statuses.push_back(documents_.at(document_id).status);
+    }
+
+    // строка на документ: hits[i * stride] - встретилось минус-слово,
+    // hits[i * stride + 1 + j] - встретилось j-е плюс-слово
+    std::vector<ResolvedTerm> match_scratch;
+    const std::vector<ResolvedTerm>& plus_terms = GetMatchTerms(query, match_scratch);
+    const size_t stride = plus_terms.size() + 1;
+    std::vector<char> hits(batch_size * stride, 0);
+    // обязательные слова - среди плюс-слов
+    std::vector<size_t> required_columns;
+    for (size_t j = 0; j < plus_terms.size(); ++j) {
+        if (std::any_of(query.required_terms.begin(), query.required_terms.end(), [&](const ResolvedTerm& term) {
+                return term.word == plus_terms[j].word;
+            })) {
+            required_columns.push_back(1 + j);
+        }
+    }
+
+    const auto mark_range = [&](size_t first, size_t last) {
+        for (const ResolvedTerm& term : query.minus_terms) {
+            MarkPostingMatches(*term.postings, ids, first, last, hits.data(), stride);
+        }
+        for (size_t j = 0; j < plus_terms.size(); ++j) {
+            MarkPostingMatches(*plus_terms[j].postings, ids, first, last, hits.data() + 1 + j, stride);
+        }
+    };
+
+    if (std::is_same_v<ExecutionPolicy, std::execution::parallel_policy> && batch_size > PARALLEL_MATCH_BATCH_SIZE) {
+        // каждая часть пачки пишет только в свои строки hits
+        std::vector<size_t> chunk_starts;
+        for (size_t first = 0; first < batch_size; first += PARALLEL_MATCH_BATCH_SIZE) {
+            chunk_starts.push_back(first);
+        }
+        std::for_each(policy, chunk_starts.begin(), chunk_starts.end(), [&](size_t first) {
+            mark_range(first, std::min(batch_size, first + PARALLEL_MATCH_BATCH_SIZE));
+        });
+    } else {
+        mark_range(0, batch_size);
+    }
+
+    result.word_offsets.reserve(batch_size + 1);
+    result.word_offsets.push_back(0);
+    for (size_t i = 0; i < batch_size; ++i) {
+        const char* row = hits.data() + i * stride;
+        const bool has_required = !query.has_unmatched_required_words
+            && std::all_of(required_columns.begin(), required_columns.end(), [row](size_t column) {
+                   return row[column] != 0;
+               });
+        if (!row[0] && has_required) {
+            for (size_t j = 0; j < plus_terms.size(); ++j) {
+                if (row[1 + j]) {
+                    result.words.push_back(plus_terms[j].word);
+                }
+            }
+        }
+        result.word_offsets.push_back(result.words.size());
+    }
+
+    return result;
 }
 
 bool SearchServer::IsStopWord(std::string_view word) const {
@@ -126,9 +938,9 @@ bool SearchServer::IsValidWord(std::string_view word) {
     });
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
+std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text, std::string& storage) const {
     std::vector<std::string_view> words;
-    for (const std::string_view word : SplitIntoWords(text)) {
+    for (const std::string_view word : text_normalizer_ ? text_normalizer_->Split(text, storage) : SplitIntoWords(text)) {
         if (!SearchServer::IsValidWord(word)) {
             throw std::invalid_argument("Word " + std::string(word) + " is invalid");
         }
@@ -153,31 +965,46 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view word) cons
         throw std::invalid_argument("Query word is empty");
     }
     bool is_minus = false;
+    bool is_required = false;
     if (word[0] == '-') {
         is_minus = true;
         word.remove_prefix(1);
+    } else if (word[0] == '+') {
+        is_required = true;
+        word.remove_prefix(1);
+    }
+    bool is_prefix = false;
+    if (word.size() > 1 && word.back() == '*') {
+        is_prefix = true;
+        word.remove_suffix(1);
     }
-    if (word.empty() || word[0] == '-' || !SearchServer::IsValidWord(word)) {
+    // обязательные бывают только целые слова
+    if (word.empty() || word[0] == '-' || word[0] == '+' || (is_prefix && (is_required || word.back() == '*'))
+        || !SearchServer::IsValidWord(word)) {
         throw std::invalid_argument("Query word " + std::string(word) + " is invalid");
     }
 
-    return {word, is_minus, SearchServer::IsStopWord(word)};
+    return {word, is_minus, !is_prefix && SearchServer::IsStopWord(word), is_prefix, is_required};
 }
 
 double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const {
-    return std::log(SearchServer::GetDocumentCount() * 1.0 / SearchServer::word_to_document_freqs_.at(std::string(word)).size());
+    return ComputeInverseDocumentFreq(scoring_policy_, GetDocumentCount(), word_to_document_freqs_.at(word).size());
+}
+
+double SearchServer::GetAverageDocumentLength() const {
+    return documents_.empty() ? 0.0 : total_word_count_ * 1.0 / documents_.size();
 }
 
-std::set<int>::iterator SearchServer::begin() {
+std::pmr::set<int>::iterator SearchServer::begin() {
     return document_ids_.begin();
 }
 
-std::set<int>::iterator SearchServer::end() {
+std::pmr::set<int>::iterator SearchServer::end() {
     return document_ids_.end();
 }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    static const std::map<std::string_view, double> result;
+const SearchServer::WordFrequencies& SearchServer::GetWordFrequencies(int document_id) const {
+    static const WordFrequencies result;
     if (documents_.find(document_id) != documents_.end()) {
         return document_ids_with_word_.at(document_id);
     }
@@ -185,18 +1012,221 @@ const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int d
     return result;
 }
 
+void SearchServer::PrepareBatch(const std::vector<Query>& parsed_queries, std::vector<ResolvedTerm>& terms,
+                                std::vector<BatchQuery>& batch_queries, std::vector<size_t>& single_queries) const {
+    std::vector<std::string_view> words;
+    for (size_t i = 0; i < parsed_queries.size(); ++i) {
+        const Query& query = parsed_queries[i];
+        if (!query.plus_prefixes.empty() || !query.minus_prefixes.empty() || !query.required_words.empty()) {
+            single_queries.push_back(i);
+            continue;
+        }
+        words.insert(words.end(), query.plus_words.begin(), query.plus_words.end());
+        words.insert(words.end(), query.minus_words.begin(), query.minus_words.end());
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    // слова идут по алфавиту, поэтому номера слов запроса возрастают в том же
+    // порядке, в каком FindAllDocuments складывает их вклады
+    const size_t NOT_FOUND = static_cast<size_t>(-1);
+    std::vector<size_t> word_terms(words.size(), NOT_FOUND);
+    for (size_t i = 0; i < words.size(); ++i) {
+        const auto it = word_to_document_freqs_.find(words[i]);
+        if (it != word_to_document_freqs_.end() && !it->second.empty()) {
+            word_terms[i] = terms.size();
+            terms.push_back({it->first, &it->second, ComputeWordInverseDocumentFreq(it->first)});
+        }
+    }
+    const auto find_term = [&words, &word_terms](std::string_view word) {
+        return word_terms[std::lower_bound(words.begin(), words.end(), word) - words.begin()];
+    };
+
+    for (size_t i = 0; i < parsed_queries.size(); ++i) {
+        const Query& query = parsed_queries[i];
+        if (!query.plus_prefixes.empty() || !query.minus_prefixes.empty() || !query.required_words.empty()) {
+            continue;
+        }
+        BatchQuery batch_query;
+        batch_query.index = i;
+        for (const std::string_view word : query.plus_words) {
+            const size_t term = find_term(word);
+            if (term == NOT_FOUND) {
+                batch_query.has_unmatched_words = true;
+            } else {
+                batch_query.plus_terms.push_back(term);
+            }
+        }
+        for (const std::string_view word : query.minus_words) {
+            const size_t term = find_term(word);
+            if (term != NOT_FOUND) {
+                batch_query.minus_terms.push_back(term);
+            }
+        }
+        batch_queries.push_back(std::move(batch_query));
+    }
+
+    // запросы с общими словами - в одну группу
+    std::sort(batch_queries.begin(), batch_queries.end(), [](const BatchQuery& lhs, const BatchQuery& rhs) {
+        return lhs.plus_terms < rhs.plus_terms;
+    });
+}
+
+void SearchServer::FindBatchGroup(const std::vector<ResolvedTerm>& terms, const BatchQuery* queries, size_t query_count,
+                                  const std::vector<std::string>& raw_queries, DocumentStatus status,
+                                  std::vector<std::vector<Document>>& results) const {
+    VisitScorer(GetAverageDocumentLength(), [&](const auto& scorer) {
+        FindBatchGroup(terms, queries, query_count, raw_queries, status, scorer, results);
+    });
+}
+
+template <typename Scorer>
+void SearchServer::FindBatchGroup(const std::vector<ResolvedTerm>& terms, const BatchQuery* queries, size_t query_count,
+                                  const std::vector<std::string>& raw_queries, DocumentStatus status, const Scorer& scorer,
+                                  std::vector<std::vector<Document>>& results) const {
+    // слово группы и запросы, в которых оно плюс- или минус-слово
+    struct GroupTerm {
+        const ResolvedTerm* term;
+        std::vector<size_t> plus_queries;
+        std::vector<size_t> minus_queries;
+        PostingList::const_iterator plus_it;
+        PostingList::const_iterator minus_it;
+    };
+    std::map<size_t, GroupTerm> term_users;
+    for (size_t q = 0; q < query_count; ++q) {
+        for (const size_t term : queries[q].plus_terms) {
+            term_users[term].plus_queries.push_back(q);
+        }
+        for (const size_t term : queries[q].minus_terms) {
+            term_users[term].minus_queries.push_back(q);
+        }
+    }
+    std::vector<GroupTerm> group_terms;
+    group_terms.reserve(term_users.size());
+    for (auto& [term, users] : term_users) {
+        users.term = &terms[term];
+        users.plus_it = users.minus_it = terms[term].postings->begin();
+        group_terms.push_back(std::move(users));
+    }
+
+    // накопители релевантности документов блока [block_begin, block_begin + BATCH_BLOCK_SIZE)
+    // для всех запросов группы; состояние: 0 - документ не найден, 1 - найден, 2 - исключён минус-словом
+    std::vector<double> relevance(query_count * BATCH_BLOCK_SIZE);
+    std::vector<uint8_t> state(query_count * BATCH_BLOCK_SIZE);
+    std::vector<std::vector<size_t>> found_slots(query_count);
+    // документы блока, проверенные по статусу: nullptr - ещё не проверен или не подходит
+    std::vector<const DocumentData*> block_documents(BATCH_BLOCK_SIZE);
+    std::vector<uint8_t> is_checked(BATCH_BLOCK_SIZE);
+    std::vector<std::vector<Document>> matched_documents(query_count);
+
+    while (true) {
+        // блоки идут по возрастанию id, пропуская диапазоны без документов
+        int64_t block_begin = std::numeric_limits<int64_t>::max();
+        for (const GroupTerm& term : group_terms) {
+            if (!term.plus_queries.empty() && term.plus_it != term.term->postings->end()) {
+                block_begin = std::min<int64_t>(block_begin, term.plus_it->first);
+            }
+        }
+        if (block_begin == std::numeric_limits<int64_t>::max()) {
+            break;
+        }
+        const int64_t block_end = block_begin + static_cast<int64_t>(BATCH_BLOCK_SIZE);
+        std::fill(is_checked.begin(), is_checked.end(), 0);
+
+        for (GroupTerm& term : group_terms) {
+            if (term.plus_queries.empty()) {
+                continue;
+            }
+            const auto end = term.term->postings->end();
+            for (; term.plus_it != end && term.plus_it->first < block_end; ++term.plus_it) {
+                const auto [document_id, term_freq] = *term.plus_it;
+                const size_t slot = static_cast<size_t>(document_id - block_begin);
+                if (!is_checked[slot]) {
+                    is_checked[slot] = 1;
+                    const DocumentData& document_data = documents_.at(document_id);
+                    block_documents[slot] = document_data.status == status ? &document_data : nullptr;
+                }
+                if (block_documents[slot] == nullptr) {
+                    continue;
+                }
+                const double contribution = scorer.Score(term_freq, block_documents[slot]->word_count, term.term->weight);
+                for (const size_t q : term.plus_queries) {
+                    const size_t cell = q * BATCH_BLOCK_SIZE + slot;
+                    if (state[cell] == 0) {
+                        state[cell] = 1;
+                        relevance[cell] = 0.0;
+                        found_slots[q].push_back(slot);
+                    }
+                    relevance[cell] += contribution;
+                }
+            }
+        }
+
+        for (GroupTerm& term : group_terms) {
+            if (term.minus_queries.empty()) {
+                continue;
+            }
+            const auto end = term.term->postings->end();
+            while (term.minus_it != end && term.minus_it->first < block_begin) {
+                ++term.minus_it;
+            }
+            for (; term.minus_it != end && term.minus_it->first < block_end; ++term.minus_it) {
+                const size_t slot = static_cast<size_t>(term.minus_it->first - block_begin);
+                for (const size_t q : term.minus_queries) {
+                    uint8_t& cell_state = state[q * BATCH_BLOCK_SIZE + slot];
+                    if (cell_state == 1) {
+                        cell_state = 2;
+                    }
+                }
+            }
+        }
+
+        // документы каждого запроса - по возрастанию id, как в FindAllDocuments
+        for (size_t q = 0; q < query_count; ++q) {
+            std::sort(found_slots[q].begin(), found_slots[q].end());
+            for (const size_t slot : found_slots[q]) {
+                const size_t cell = q * BATCH_BLOCK_SIZE + slot;
+                if (state[cell] == 1) {
+                    matched_documents[q].push_back({static_cast<int>(block_begin + static_cast<int64_t>(slot)),
+                                                    relevance[cell], block_documents[slot]->rating});
+                }
+                state[cell] = 0;
+            }
+            found_slots[q].clear();
+        }
+    }
+
+    for (size_t q = 0; q < query_count; ++q) {
+        const BatchQuery& query = queries[q];
+        std::vector<Document>& documents = matched_documents[q];
+        // повтор с исправленными словами - как в FindMatchedDocuments
+        if (fuzzy_options_ && query.has_unmatched_words && documents.size() < fuzzy_options_->min_results) {
+            results[query.index] = FindTopDocuments(std::execution::seq, raw_queries[query.index], status);
+            continue;
+        }
+        SelectTopDocuments(std::execution::seq, documents, MAX_RESULT_DOCUMENT_COUNT);
+        results[query.index] = std::move(documents);
+    }
+}
+
 void SearchServer::RemoveDocument(int document_id) {
 
-    if (document_ids_.find(document_id) != document_ids_.end()) {
+    if (document_ids_.find(document_id) == document_ids_.end()) {
              return;
     }
 
     for (const auto& [word, freq] : document_ids_with_word_.at(document_id)) {
         word_to_document_freqs_.at(word).erase(document_id);
+        if (has_impact_index_) {
+            word_to_impacts_.at(word).erase({freq, document_id});
+        }
     }
+    RemoveFromResultCache(document_id);
+    total_word_count_ -= documents_.at(document_id).word_count;
     document_ids_.erase(document_id);
     document_ids_with_word_.erase(document_id);
     documents_.erase(document_id);
+    ++index_version_;
 }
 
 
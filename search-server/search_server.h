@@ -2,7 +2,20 @@
 
 #include "string_processing.h"
 #include "concurrent_map.h"
+#include "prepared_query.h"
+#include "matched_documents.h"
+#include "search_stats.h"
+#include "search_control.h"
+#include "search_budget.h"
+#include "term_statistics.h"
+#include "search_page.h"
+#include "fuzzy_match.h"
 #include "document.h"
+#include "trace.h"
+#include "memory_resources.h"
+#include "result_cache.h"
+#include "scoring.h"
+#include "text_normalizer.h"
 
 #include <stdexcept>
 #include <algorithm>
@@ -12,21 +25,49 @@
 #include <tuple>
 #include <set>
 #include <map>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <optional>
+#include <memory_resource>
 #include <execution>
+#include <thread>
+#include <type_traits>
+#include <variant>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <limits>
 
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 const double EPSILON = 1e-6; // точность сравнения релевантности (double)
 const int MAP_BUCKETS = 101;
+// FindTopDocumentsBatch: запросов в группе и id документов в блоке;
+// накопители релевантности группы (запросы * блок) помещаются в L2
+const size_t BATCH_GROUP_SIZE = 64;
+const size_t BATCH_BLOCK_SIZE = 1024;
+// сколько слов словаря по умолчанию подставляется вместо слова-префикса
+const size_t DEFAULT_PREFIX_EXPANSION_LIMIT = 64;
+// с какого размера пачки MatchDocuments(par) делит её между потоками
+const size_t PARALLEL_MATCH_BATCH_SIZE = 256;
+// PostingCursor::Seek: сколько документов перебирается до поиска от корня дерева
+const size_t POSTING_SEEK_STEPS = 8;
 
 
 
 class SearchServer {
 public:
+    // узлы индекса берутся из index_resource; он должен пережить сервер
+    // и быть потокобезопасным, если используется RemoveDocument(par)
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words) ;
-    explicit SearchServer(const std::string& stop_words_text) ;
-    explicit SearchServer(const std::string_view stop_words_text) ;
+    explicit SearchServer(const StringContainer& stop_words,
+                          std::pmr::memory_resource* index_resource = std::pmr::get_default_resource()) ;
+    explicit SearchServer(const std::string& stop_words_text,
+                          std::pmr::memory_resource* index_resource = std::pmr::get_default_resource()) ;
+    explicit SearchServer(const std::string_view stop_words_text,
+                          std::pmr::memory_resource* index_resource = std::pmr::get_default_resource()) ;
 
     void AddDocument(int document_id,
                      std::string_view document,
@@ -62,17 +103,220 @@ public:
     FindTopDocuments(const ExecutionPolicy& policy,
                      const std::string_view raw_query) const;
 
+    // поиск, прерываемый по сроку или отмене из control; тогда возвращаются лучшие
+    // из уже оценённых документов, а причина остановки - в control.GetOutcome()
+    template <typename ExecutionPolicy, typename Predicate>
+    std::vector<Document>
+    FindTopDocuments(const ExecutionPolicy& policy,
+                     const std::string_view raw_query,
+                     Predicate document_predicate,
+                     const SearchControl& control) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document>
+    FindTopDocuments(const ExecutionPolicy& policy,
+                     const std::string_view raw_query,
+                     DocumentStatus status,
+                     const SearchControl& control) const;
+
+    // поиск в пределах budget по индексу влияния (см. EnableImpactIndex);
+    // без индекса и для запросов с обязательными словами выполняется обычный полный поиск
+    template <typename Predicate>
+    ApproximateTopDocuments
+    FindTopDocuments(const std::string_view raw_query,
+                     Predicate document_predicate,
+                     const SearchBudget& budget) const;
+
+    ApproximateTopDocuments
+    FindTopDocuments(const std::string_view raw_query,
+                     DocumentStatus status,
+                     const SearchBudget& budget) const;
+
+    ApproximateTopDocuments
+    FindTopDocuments(const std::string_view raw_query,
+                     const SearchBudget& budget) const;
+
+    // документные частоты плюс-слов запроса (и раскрытых префиксов) в этом индексе
+    TermStatistics GetTermStatistics(std::string_view raw_query) const;
+
+    // поиск с IDF по общей статистике нескольких индексов (см. ShardAggregator)
+    template <typename ExecutionPolicy>
+    std::vector<Document>
+    FindTopDocuments(const ExecutionPolicy& policy,
+                     const std::string_view raw_query,
+                     DocumentStatus status,
+                     const TermStatistics& statistics) const;
+
+    // разбирает запрос один раз для многократного использования
+    PreparedQuery PrepareQuery(std::string_view raw_query) const;
+
+    // заново сопоставляет слова запроса с изменившимся индексом
+    void RefreshQuery(PreparedQuery& query) const;
+
+    template <typename Predicate>
+    std::vector<Document>
+    FindTopDocuments(const PreparedQuery& query,
+                     Predicate document_predicate) const;
+
+    std::vector<Document>
+    FindTopDocuments(const PreparedQuery& query,
+                     DocumentStatus status) const;
+
+    std::vector<Document>
+    FindTopDocuments(const PreparedQuery& query) const;
+
+    template <typename ExecutionPolicy, typename Predicate>
+    std::vector<Document>
+    FindTopDocuments(const ExecutionPolicy& policy,
+                     const PreparedQuery& query,
+                     Predicate document_predicate) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document>
+    FindTopDocuments(const ExecutionPolicy& policy,
+                     const PreparedQuery& query,
+                     DocumentStatus status) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document>
+    FindTopDocuments(const ExecutionPolicy& policy,
+                     const PreparedQuery& query) const;
+
+    // страница результатов; упорядочиваются только offset + limit лучших документов
+    template <typename ExecutionPolicy, typename Predicate>
+    SearchPage
+    FindTopDocumentsPage(const ExecutionPolicy& policy,
+                         const std::string_view raw_query,
+                         Predicate document_predicate,
+                         const PageRequest& page) const;
+
+    template <typename ExecutionPolicy>
+    SearchPage
+    FindTopDocumentsPage(const ExecutionPolicy& policy,
+                         const std::string_view raw_query,
+                         DocumentStatus status,
+                         const PageRequest& page) const;
+
+    template <typename ExecutionPolicy>
+    SearchPage
+    FindTopDocumentsPage(const ExecutionPolicy& policy,
+                         const std::string_view raw_query,
+                         const PageRequest& page) const;
+
+    template <typename ExecutionPolicy, typename Predicate>
+    SearchPage
+    FindTopDocumentsPage(const ExecutionPolicy& policy,
+                         const PreparedQuery& query,
+                         Predicate document_predicate,
+                         const PageRequest& page) const;
+
+    template <typename ExecutionPolicy>
+    SearchPage
+    FindTopDocumentsPage(const ExecutionPolicy& policy,
+                         const PreparedQuery& query,
+                         DocumentStatus status,
+                         const PageRequest& page) const;
+
+    template <typename ExecutionPolicy>
+    SearchPage
+    FindTopDocumentsPage(const ExecutionPolicy& policy,
+                         const PreparedQuery& query,
+                         const PageRequest& page) const;
+
+    // то же, что FindTopDocuments, но заполняет stats счётчиками и временем этапов поиска
+    template <typename ExecutionPolicy, typename Predicate>
+    std::vector<Document>
+    ExplainTopDocuments(const ExecutionPolicy& policy,
+                        const std::string_view raw_query,
+                        Predicate document_predicate,
+                        SearchStats& stats) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document>
+    ExplainTopDocuments(const ExecutionPolicy& policy,
+                        const std::string_view raw_query,
+                        DocumentStatus status,
+                        SearchStats& stats) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document>
+    ExplainTopDocuments(const ExecutionPolicy& policy,
+                        const std::string_view raw_query,
+                        SearchStats& stats) const;
+
+    // результаты FindTopDocuments(raw_query, status) для каждого запроса пачки; запросы
+    // оцениваются группами, и список документов слова проходится один раз на группу;
+    // если в пачке есть некорректный запрос, бросает std::invalid_argument
+    template <typename ExecutionPolicy>
+    std::vector<std::vector<Document>>
+    FindTopDocumentsBatch(const ExecutionPolicy& policy,
+                          const std::vector<std::string>& raw_queries,
+                          DocumentStatus status = DocumentStatus::ACTUAL) const;
+
     int GetDocumentCount() const ;
 
+    // увеличивается при каждом изменении индекса
+    uint64_t GetIndexVersion() const ;
+
+    // ограничивает число слов словаря, в которые раскрывается плюс-слово-префикс (слово*):
+    // остаются слова из наибольшего числа документов. Минус-префикс раскрывается полностью
+    void SetPrefixExpansionLimit(size_t limit) ;
+
+    // если точный поиск нашёл меньше options.min_results документов, слова запроса,
+    // которых нет в словаре, заменяются близкими по расстоянию Левенштейна
+    void EnableFuzzyMatching(const FuzzyMatchOptions& options = {}) ;
+    void DisableFuzzyMatching() ;
+
+    // строит вторичный индекс: списки документов слов по убыванию TF;
+    // затем он поддерживается при добавлении и удалении документов
+    void EnableImpactIndex() ;
+    void DisableImpactIndex() ;
+
+    // способ подсчёта релевантности (TF-IDF или BM25); тип оценщика выбирается
+    // один раз на запрос, и цикл по спискам документов специализирован под него.
+    // Кэш результатов работает только с TF-IDF
+    void SetScoringPolicy(const ScoringPolicy& scoring_policy) ;
+    const ScoringPolicy& GetScoringPolicy() const ;
+
+    // запросы из одного-двух плюс-слов со статусом ACTUAL, встречающиеся чаще других,
+    // получают готовые списки лучших документов; списки обновляются при добавлении
+    // и удалении документов, а выдача совпадает с обычным поиском
+    void EnableResultCache(const ResultCacheOptions& options = {}) ;
+    void DisableResultCache() ;
+    ResultCacheStats GetResultCacheStats() const ;
+
+    // документы, стоп-слова и запросы делятся на слова с помощью TextNormalizer:
+    // разделители - пробельные символы Юникода и знаки препинания, регистр букв
+    // не различается. Вызывается до добавления документов
+    void EnableTextNormalization(const TextNormalizerOptions& options = {}) ;
+
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const ;
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy& sequen, std::string_view raw_query, int document_id) const ;
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy&  paral, std::string_view raw_query, int document_id) const ;
 
-    std::set<int>::iterator begin();
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const PreparedQuery& query, int document_id) const ;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy& sequen, const PreparedQuery& query, int document_id) const ;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy&  paral, const PreparedQuery& query, int document_id) const ;
+
+    // сопоставляет запрос сразу с пачкой документов за один проход по спискам документов слов
+    MatchedDocuments MatchDocuments(std::string_view raw_query, const std::vector<int>& document_ids) const ;
+    MatchedDocuments MatchDocuments(const std::execution::sequenced_policy& sequen, std::string_view raw_query, const std::vector<int>& document_ids) const ;
+    MatchedDocuments MatchDocuments(const std::execution::parallel_policy&  paral, std::string_view raw_query, const std::vector<int>& document_ids) const ;
+
+    MatchedDocuments MatchDocuments(const PreparedQuery& query, const std::vector<int>& document_ids) const ;
+    MatchedDocuments MatchDocuments(const std::execution::sequenced_policy& sequen, const PreparedQuery& query, const std::vector<int>& document_ids) const ;
+    MatchedDocuments MatchDocuments(const std::execution::parallel_policy&  paral, const PreparedQuery& query, const std::vector<int>& document_ids) const ;
+
+    // порядок выдачи: релевантность, затем рейтинг, затем id
+    static bool IsRankedBefore(const Document& lhs, const Document& rhs);
 
-    std::set<int>::iterator end();
+    using WordFrequencies = std::pmr::map<std::string_view, double>;
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    std::pmr::set<int>::iterator begin();
+
+    std::pmr::set<int>::iterator end();
+
+    const WordFrequencies& GetWordFrequencies(int document_id) const;
 
     void RemoveDocument(int document_id);
 
@@ -84,22 +328,65 @@ private:
     struct DocumentData {
         int rating;
         DocumentStatus status;
+        // слов без стоп-слов, для нормировки BM25
+        int word_count;
     };
 
+    // (TF, id документа) по убыванию TF
+    using ImpactList = std::pmr::set<std::pair<double, int>, std::greater<>>;
+
+
+    std::set<std::string, std::less<>> stop_words_;
+    std::pmr::set<std::pmr::string, std::less<>> words_;
+    std::pmr::map<std::string_view, PostingList> word_to_document_freqs_;
+
+    std::pmr::map<int, DocumentData> documents_;
+    std::pmr::set<int> document_ids_;
+    std::pmr::map<int, WordFrequencies> document_ids_with_word_;
+    uint64_t index_version_ = 0;
+
+    // номер экземпляра: версии индекса разных серверов совпадают, а подготовленный запрос
+    // хранит указатели на списки документов своего сервера. Копия получает новый номер
+    class InstanceId {
+    public:
+        InstanceId()
+            : value_(Next()) {
+        }
+        InstanceId(const InstanceId&)
+            : value_(Next()) {
+        }
+        InstanceId& operator=(const InstanceId&) {
+            value_ = Next();
+            return *this;
+        }
 
-    const std::set<std::string_view, std::less<>> stop_words_;
-    std::set<std::string, std::less<>> words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
+        uint64_t Get() const {
+            return value_;
+        }
+
+    private:
+        static uint64_t Next();
 
-    std::map<int, DocumentData> documents_;
-    std::set<int> document_ids_;
-    std::map<int, std::map<std::string_view, double>> document_ids_with_word_;
+        uint64_t value_;
+    };
+    InstanceId instance_id_;
+    size_t prefix_expansion_limit_ = DEFAULT_PREFIX_EXPANSION_LIMIT;
+    std::optional<FuzzyMatchOptions> fuzzy_options_;
+    bool has_impact_index_ = false;
+    std::pmr::map<std::string_view, ImpactList> word_to_impacts_;
+    // меняется и при поиске, поэтому mutable; доступ к части кэша под её Lock()
+    mutable std::optional<ResultCache> result_cache_;
+    ScoringPolicy scoring_policy_;
+    // сумма word_count всех документов
+    int64_t total_word_count_ = 0;
+    std::optional<TextNormalizer> text_normalizer_;
 
     bool IsStopWord(std::string_view word) const ;
 
     static bool IsValidWord(std::string_view word) ;
 
-    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const ;
+    // при нормализации слова указывают на storage
+    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text, std::string& storage) const ;
 
     static int ComputeAverageRating(const std::vector<int>& ratings) ;
 
@@ -107,13 +394,15 @@ private:
         std::string_view data;
         bool is_minus;
         bool is_stop;
+        bool is_prefix;
+        bool is_required;
     };
 
     QueryWord ParseQueryWord(std::string_view text) const ;
 
-    struct Query {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+    // слова указывают на текст запроса или, при нормализации, на normalized_text
+    struct Query : QueryWords<std::string_view> {
+        std::unique_ptr<std::string> normalized_text;
     };
 
     template <typename ExecutionPolicy>
@@ -121,15 +410,178 @@ private:
 
     double ComputeWordInverseDocumentFreq(const std::string_view word) const ;
 
-    template <typename Predicate>
-    std::vector<Document> FindAllDocuments(const Query& query, Predicate document_predicate) const;
+    double GetAverageDocumentLength() const ;
 
-    template <typename Predicate>
-    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy& policy, const Query& query, Predicate document_predicate) const;
+    // вызывает function с оценщиком текущей политики подсчёта релевантности
+    template <typename Function>
+    decltype(auto) VisitScorer(double average_document_length, Function function) const;
 
-    template <typename Predicate>
+    template <typename Words>
+    std::vector<ResolvedTerm> ResolveTerms(const Words& words, std::vector<std::string>* unmatched_words = nullptr) const;
+
+    // слова словаря, начинающиеся с prefix, по алфавиту; если их больше limit -
+    // limit слов из наибольшего числа документов
+    std::vector<ResolvedTerm> ExpandPrefix(std::string_view prefix, size_t limit) const;
+
+    // слова словаря на расстоянии от 1 до max_distance от word, ближайшие первыми;
+    // обход словаря прекращается после deadline
+    std::vector<ResolvedTerm> ExpandFuzzy(std::string_view word, int max_distance,
+                                          std::chrono::steady_clock::time_point deadline) const;
+
+    // копия query, где ненайденные слова раскрыты в близкие слова словаря
+    ResolvedQuery ResolveFuzzy(const ResolvedQuery& query) const;
+
+    std::vector<std::pair<int, double>> MergePostings(const std::vector<ResolvedTerm>& terms, double average_document_length) const;
+
+    template <typename Scorer>
+    std::vector<std::pair<int, double>> MergeScoredPostings(const std::vector<ResolvedTerm>& terms, const Scorer& scorer) const;
+
+    template <typename String>
+    ResolvedQuery ResolveQuery(const QueryWords<String>& query) const;
+
+    // заменяет IDF слов запроса и среднюю длину документа на посчитанные по statistics
+    void ApplyTermStatistics(ResolvedQuery& query, const TermStatistics& statistics) const;
+
+    // плюс-слова запроса вместе с раскрытыми префиксами, по алфавиту;
+    // при наличии префиксов список строится в scratch
+    static const std::vector<ResolvedTerm>& GetMatchTerms(const ResolvedQuery& query, std::vector<ResolvedTerm>& scratch);
+
+    // возвращает сопоставление запроса с текущей версией индекса;
+    // для устаревшего запроса оно строится в scratch
+    const ResolvedQuery& GetResolvedQuery(const PreparedQuery& query, ResolvedQuery& scratch) const;
+
+    // сопоставление запроса сделано этим сервером и с текущей версией индекса
+    bool IsResolvedByThisServer(const PreparedQuery& query) const;
+
+    // оставляет в documents count лучших документов в порядке выдачи
+    template <typename ExecutionPolicy>
+    static void SelectTopDocuments(const ExecutionPolicy& policy, std::vector<Document>& documents, size_t count);
+
+    // std::for_each(policy, ...), из которого исключение не приводит к std::terminate:
+    // после первого исключения оставшиеся вызовы пропускаются, и оно бросается дальше
+    template <typename ExecutionPolicy, typename Iterator, typename Function>
+    static void ForEachRethrowing(const ExecutionPolicy& policy, Iterator first, Iterator last, Function function);
+
+    // FindAllDocuments с повтором по исправленным словам, если найдено слишком мало
+    template <typename ExecutionPolicy, typename Predicate>
+    std::vector<Document> FindMatchedDocuments(const ExecutionPolicy& policy, const ResolvedQuery& query, Predicate document_predicate, SearchStats* stats = nullptr, const SearchControl* control = nullptr) const;
+
+    template <typename ExecutionPolicy, typename Predicate>
+    SearchPage FindPageResolved(const ExecutionPolicy& policy, const ResolvedQuery& query, Predicate document_predicate, const PageRequest& page) const;
+
+    template <typename ExecutionPolicy, typename Predicate>
+    std::vector<Document> FindTopResolved(const ExecutionPolicy& policy, const ResolvedQuery& query, Predicate document_predicate, SearchStats* stats = nullptr, const SearchControl* control = nullptr) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchResolved(const std::execution::sequenced_policy& policy, const ResolvedQuery& query, int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchResolved(const std::execution::parallel_policy& policy, const ResolvedQuery& query, int document_id) const;
+
+    // запрос пачки FindTopDocumentsBatch: номера его слов в общем списке слов пачки,
+    // по возрастанию (как слова в запросе)
+    struct BatchQuery {
+        size_t index = 0;
+        std::vector<size_t> plus_terms;
+        std::vector<size_t> minus_terms;
+        bool has_unmatched_words = false;
+    };
+
+    // сопоставляет слова всех запросов со словарём один раз; запросы с префиксами и обязательными словами
+    // попадают в single_queries и ищутся по одному
+    void PrepareBatch(const std::vector<Query>& parsed_queries, std::vector<ResolvedTerm>& terms,
+                      std::vector<BatchQuery>& batch_queries, std::vector<size_t>& single_queries) const;
+
+    // выдача из кэша результатов; nullopt - запрос не подходит для кэша
+    // или по записи нельзя доказать, что выдача совпадёт с обычным поиском
+    std::optional<std::vector<Document>> FindCachedTopDocuments(const Query& query) const;
+
+    // полный проход по спискам документов слов запроса
+    ResultCacheEntry BuildResultCacheEntry(const std::vector<ResolvedTerm>& terms) const;
+
+    std::optional<std::vector<Document>> ServeResultCacheEntry(const ResultCacheEntry& entry,
+                                                               const std::vector<ResolvedTerm>& terms) const;
+
+    void AddToResultCache(int document_id);
+    void RemoveFromResultCache(int document_id);
+
+    void FindBatchGroup(const std::vector<ResolvedTerm>& terms, const BatchQuery* queries, size_t query_count,
+                        const std::vector<std::string>& raw_queries, DocumentStatus status,
+                        std::vector<std::vector<Document>>& results) const;
+
+    template <typename Scorer>
+    void FindBatchGroup(const std::vector<ResolvedTerm>& terms, const BatchQuery* queries, size_t query_count,
+                        const std::vector<std::string>& raw_queries, DocumentStatus status, const Scorer& scorer,
+                        std::vector<std::vector<Document>>& results) const;
+
+    template <typename ExecutionPolicy>
+    MatchedDocuments MatchResolvedBatch(const ExecutionPolicy& policy, const ResolvedQuery& query, const std::vector<int>& document_ids) const;
+
+    // с control подсчёт релевантности может остановиться досрочно,
+    // минус-слова при этом всё равно исключаются полностью
+    template <typename Predicate, typename Scorer>
+    std::vector<Document> FindAllDocuments(const ResolvedQuery& query, Predicate document_predicate, const Scorer& scorer, SearchStats* stats = nullptr, const SearchControl* control = nullptr) const;
+
+    // позиция в списке документов слова
+    struct PostingCursor {
+        const PostingList* postings;
+        PostingList::const_iterator it;
+
+        // переходит к первому документу с id не меньше document_id: рядом - перебором,
+        // далеко - поиском от корня; true, если это сам document_id
+        bool Seek(int document_id) {
+            const auto end = postings->end();
+            for (size_t step = 0; it != end && it->first < document_id; ++step) {
+                if (step == POSTING_SEEK_STEPS) {
+                    it = postings->lower_bound(document_id);
+                    break;
+                }
+                ++it;
+            }
+            return it != end && it->first == document_id;
+        }
+    };
+
+    // первый элемент [first, last) с id не меньше document_id: шаги 1, 2, 4, ...,
+    // затем двоичный поиск в последнем шаге
+    template <typename Iterator>
+    static Iterator GallopTo(Iterator first, Iterator last, int document_id);
+
+    // запрос с обязательными словами: их списки документов пересекаются начиная
+    // с самого короткого, и релевантность считается только для документов пересечения
+    template <typename Predicate, typename Scorer>
+    std::vector<Document> FindRequiredDocuments(const ResolvedQuery& query, Predicate document_predicate, const Scorer& scorer, SearchStats* stats, const SearchControl* control) const;
+
+    // позиция в списке влияния одного слова запроса
+    struct ImpactCursor {
+        ImpactList::const_iterator it;
+        ImpactList::const_iterator end;
+        double weight;
+
+        // наибольший вклад этого и следующих документов списка
+        template <typename Scorer>
+        double GetImpact(const Scorer& scorer) const {
+            return scorer.GetUpperBound(it->first, weight);
+        }
+    };
+
+    // плюс-слова и все раскрытые слова запроса
+    static std::vector<ResolvedTerm> GetScoringTerms(const ResolvedQuery& query);
+
+    // поиск "по одному документу за раз": из всех слов запроса берётся документ
+    // с наибольшим вкладом, пока не кончатся списки или бюджет
+    template <typename Predicate, typename Scorer>
+    ApproximateTopDocuments FindTopImpactOrdered(const ResolvedQuery& query, Predicate document_predicate, const SearchBudget& budget, const Scorer& scorer) const;
+
+    // после остановки по бюджету досчитывает лучших кандидатов точно
+    // и проверяет, что непросмотренные документы не могли попасть в выдачу
+    void RefineTopDocuments(const ResolvedQuery& query, const std::vector<ResolvedTerm>& terms,
+                            const std::pmr::map<int, double>& partial_relevance, double remaining_bound,
+                            size_t max_refinements, ApproximateTopDocuments& result) const;
+
+    template <typename Predicate, typename Scorer>
+    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy& policy, const ResolvedQuery& query, Predicate document_predicate, const Scorer& scorer, SearchStats* stats = nullptr, const SearchControl* control = nullptr) const;
+
+    template <typename Predicate, typename Scorer>
     std::vector<Document>
-    FindAllDocuments(const std::execution::parallel_policy& policy, const Query& query, Predicate document_predicate) const;
+    FindAllDocuments(const std::execution::parallel_policy& policy, const ResolvedQuery& query, Predicate document_predicate, const Scorer& scorer, SearchStats* stats = nullptr, const SearchControl* control = nullptr) const;
 };
 
 
@@ -137,135 +589,625 @@ template <typename ExecutionPolicy>
 SearchServer::Query
 SearchServer::ParseQuery(const ExecutionPolicy& policy, const std::string_view text, const bool make_unique) const {
     Query result;
-    bool has_minus = false;
-    bool has_plus = false;
-    const auto& words = SplitIntoWords(text);
-    for_each(words.begin(), words.end(), [this, &has_minus, &has_plus, &result] (std::string_view word) {
-                 const auto query_word = ParseQueryWord(word);
-                 if (!query_word.is_stop) {
-                     if (query_word.is_minus) {
-                         has_minus = true;
-                         result.minus_words.push_back(query_word.data);
-                     } else {
-                         has_plus = true;
-                         result.plus_words.push_back(query_word.data);
-                     }
-                 }
-             });
+    const auto add_word = [&result](const QueryWord& query_word) {
+        if (query_word.is_stop) {
+            return;
+        }
+        if (query_word.is_prefix) {
+            (query_word.is_minus ? result.minus_prefixes : result.plus_prefixes).push_back(query_word.data);
+        } else if (query_word.is_required) {
+            result.required_words.push_back(query_word.data);
+            result.plus_words.push_back(query_word.data);
+        } else if (query_word.is_minus) {
+            result.minus_words.push_back(query_word.data);
+        } else {
+            result.plus_words.push_back(query_word.data);
+        }
+    };
+
+    if (!text_normalizer_) {
+        for (const std::string_view word : SplitIntoWords(text)) {
+            add_word(ParseQueryWord(word));
+        }
+    } else {
+        // нормализация не меняет смещений: слово без знаков -, + и * берётся из нормализованного
+        // текста по тому же месту и может распасться на несколько слов ("-рок-н-ролл")
+        result.normalized_text = std::make_unique<std::string>();
+        text_normalizer_->Normalize(text, *result.normalized_text);
+        const std::string_view normalized_text = *result.normalized_text;
+        for (const std::string_view word : text_normalizer_->SplitWhitespace(text)) {
+            const QueryWord query_word = ParseQueryWord(word);
+            const auto parts = SplitIntoWords(normalized_text.substr(query_word.data.data() - text.data(), query_word.data.size()));
+            for (size_t i = 0; i < parts.size(); ++i) {
+                QueryWord part = query_word;
+                part.data = parts[i];
+                // префикс - только последняя часть
+                part.is_prefix = query_word.is_prefix && i + 1 == parts.size();
+                part.is_stop = !part.is_prefix && IsStopWord(part.data);
+                add_word(part);
+            }
+        }
+    }
 
     if (!make_unique) {
         return result;
     }
 
-    if (has_minus) {
-        std::sort(policy, result.minus_words.begin(), result.minus_words.end());
-        auto it = std::unique(policy, result.minus_words.begin(), result.minus_words.end());
-        result.minus_words.erase(it, result.minus_words.end());
-    }
-    if (has_plus) {
-        std::sort(policy, result.plus_words.begin(), result.plus_words.end());
-        auto it = std::unique(policy, result.plus_words.begin(), result.plus_words.end());
-        result.plus_words.erase(it, result.plus_words.end());
+    for (auto* query_words : {&result.plus_words, &result.required_words, &result.minus_words,
+                              &result.plus_prefixes, &result.minus_prefixes}) {
+        if (query_words->size() > 1) {
+            std::sort(policy, query_words->begin(), query_words->end());
+            auto it = std::unique(policy, query_words->begin(), query_words->end());
+            query_words->erase(it, query_words->end());
+        }
     }
     return result;
 }
 
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words)
-        : stop_words_(MakeUniqueNonEmptyStrings(stop_words)) {
+SearchServer::SearchServer(const StringContainer& stop_words, std::pmr::memory_resource* index_resource)
+        : stop_words_(MakeUniqueNonEmptyStrings(stop_words))
+        , words_(index_resource)
+        , word_to_document_freqs_(index_resource)
+        , documents_(index_resource)
+        , document_ids_(index_resource)
+        , document_ids_with_word_(index_resource)
+        , word_to_impacts_(index_resource) {
     if (!std::all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
         throw std::invalid_argument("Some of stop words are invalid");
     }
 }
 
+template <typename Words>
+std::vector<ResolvedTerm> SearchServer::ResolveTerms(const Words& words, std::vector<std::string>* unmatched_words) const {
+    std::vector<ResolvedTerm> terms;
+    terms.reserve(words.size());
+    for (const std::string_view word : words) {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it == word_to_document_freqs_.end() || it->second.empty()) {
+            if (unmatched_words != nullptr) {
+                unmatched_words->emplace_back(word);
+            }
+            continue;
+        }
+        terms.push_back({it->first, &it->second, ComputeWordInverseDocumentFreq(it->first)});
+    }
+    return terms;
+}
+
+template <typename String>
+ResolvedQuery SearchServer::ResolveQuery(const QueryWords<String>& query) const {
+    ResolvedQuery result;
+    result.average_document_length = GetAverageDocumentLength();
+    result.plus_terms = ResolveTerms(query.plus_words, &result.unmatched_words);
+    result.required_terms = ResolveTerms(query.required_words);
+    result.has_unmatched_required_words = result.required_terms.size() < query.required_words.size();
+    result.minus_terms = ResolveTerms(query.minus_words);
+    for (const std::string_view prefix : query.plus_prefixes) {
+        ExpandedTerm term;
+        term.expansions = ExpandPrefix(prefix, prefix_expansion_limit_);
+        if (!term.expansions.empty()) {
+            term.postings = MergePostings(term.expansions, result.average_document_length);
+            result.expanded_terms.push_back(std::move(term));
+        }
+    }
+    // минус-префикс исключает документы со всеми подходящими словами, без ограничения
+    for (const std::string_view prefix : query.minus_prefixes) {
+        const auto expansions = ExpandPrefix(prefix, std::numeric_limits<size_t>::max());
+        result.minus_terms.insert(result.minus_terms.end(), expansions.begin(), expansions.end());
+    }
+    return result;
+}
+
+template <typename Function>
+decltype(auto) SearchServer::VisitScorer(double average_document_length, Function function) const {
+    return std::visit([&function, average_document_length](const auto& scoring) {
+        return function(MakeScorer(scoring, average_document_length));
+    }, scoring_policy_);
+}
+
 template <typename Predicate>
 std::vector<Document>
 SearchServer::FindTopDocuments(const std::string_view raw_query, Predicate document_predicate) const {
-    const auto query = ParseQuery(std::execution::seq, raw_query);
-    auto matched_documents = FindAllDocuments(query, document_predicate);
-    std::sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-                  if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-                      return lhs.rating > rhs.rating;
-                  } else {
-                      return lhs.relevance > rhs.relevance;
-                  }
-              });
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+}
 
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+template <typename ExecutionPolicy, typename Predicate>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query,Predicate document_predicate) const {
+    TRACE_SCOPE("FindTopDocuments");
+    ResolvedQuery query;
+    {
+        TRACE_SCOPE("ParseQuery");
+        query = ResolveQuery(ParseQuery(policy, raw_query));
     }
+    return FindTopResolved(policy, query, document_predicate);
+}
 
-    return matched_documents;
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status) const {
+    const auto document_predicate = [status](int document_id, DocumentStatus document_status, int rating) {
+        return document_status == status;
+    };
+    if (!result_cache_ || status != DocumentStatus::ACTUAL) {
+        return FindTopDocuments(policy, raw_query, document_predicate);
+    }
+
+    TRACE_SCOPE("FindTopDocuments");
+    Query words;
+    {
+        TRACE_SCOPE("ParseQuery");
+        words = ParseQuery(policy, raw_query);
+    }
+    if (auto documents = FindCachedTopDocuments(words)) {
+        return std::move(*documents);
+    }
+    return FindTopResolved(policy, ResolveQuery(words), document_predicate);
 }
 
-template <typename ExecutionPolicy, typename Predicate>
-std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query,Predicate document_predicate) const {
-    const Query query = ParseQuery(policy, raw_query);
-    std::vector<Document> matched_documents = FindAllDocuments(policy, query, document_predicate);
-    std::sort(policy, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-                  if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-                      return lhs.rating > rhs.rating;
-                  } else {
-                      return lhs.relevance > rhs.relevance;
-                  }
-              });
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
 
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+template <typename ExecutionPolicy, typename Predicate>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, Predicate document_predicate, const SearchControl& control) const {
+    TRACE_SCOPE("FindTopDocuments");
+    ResolvedQuery query;
+    {
+        TRACE_SCOPE("ParseQuery");
+        query = ResolveQuery(ParseQuery(policy, raw_query));
     }
+    return FindTopResolved(policy, query, document_predicate, nullptr, &control);
+}
 
-    return matched_documents;
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status, const SearchControl& control) const {
+    return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+                        return document_status == status;
+                    }, control);
+}
+
+template <typename Predicate>
+std::vector<Document>
+SearchServer::FindTopDocuments(const PreparedQuery& query, Predicate document_predicate) const {
+    return FindTopDocuments(std::execution::seq, query, document_predicate);
 }
 
+template <typename ExecutionPolicy, typename Predicate>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const PreparedQuery& query, Predicate document_predicate) const {
+    TRACE_SCOPE("FindTopDocuments");
+    ResolvedQuery scratch;
+    return FindTopResolved(policy, GetResolvedQuery(query, scratch), document_predicate);
+}
 
 template <typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(policy, raw_query,[status](int document_id, DocumentStatus document_status, int rating) {
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const PreparedQuery& query, DocumentStatus status) const {
+    return FindTopDocuments(policy, query, [status](int document_id, DocumentStatus document_status, int rating) {
                         return document_status == status;
                     });
 }
 
 template <typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query) const {
-    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const PreparedQuery& query) const {
+    return FindTopDocuments(policy, query, DocumentStatus::ACTUAL);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status, const TermStatistics& statistics) const {
+    TRACE_SCOPE("FindTopDocuments");
+    ResolvedQuery query;
+    {
+        TRACE_SCOPE("ParseQuery");
+        query = ResolveQuery(ParseQuery(policy, raw_query));
+        ApplyTermStatistics(query, statistics);
+    }
+    return FindTopResolved(policy, query, [status](int document_id, DocumentStatus document_status, int rating) {
+                        return document_status == status;
+                    });
 }
 
-// FindAllDocuments
 template <typename Predicate>
-std::vector<Document>
-SearchServer::FindAllDocuments(const Query& query,
-                               Predicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
+ApproximateTopDocuments SearchServer::FindTopDocuments(const std::string_view raw_query, Predicate document_predicate, const SearchBudget& budget) const {
+    TRACE_SCOPE("FindTopDocuments");
+    ResolvedQuery query;
+    {
+        TRACE_SCOPE("ParseQuery");
+        query = ResolveQuery(ParseQuery(std::execution::seq, raw_query));
+    }
+    if (has_impact_index_ && query.required_terms.empty() && !query.has_unmatched_required_words) {
+        TRACE_SCOPE("FindTopImpactOrdered");
+        return VisitScorer(query.average_document_length, [&](const auto& scorer) {
+            return FindTopImpactOrdered(query, document_predicate, budget, scorer);
+        });
+    }
 
-    for (const std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+    ApproximateTopDocuments result;
+    SearchStats stats;
+    result.documents = FindTopResolved(std::execution::seq, query, document_predicate, &stats);
+    result.is_exact = true;
+    result.postings_processed = stats.postings_traversed;
+    result.postings_total = stats.postings_traversed;
+    return result;
+}
+
+template <typename Predicate, typename Scorer>
+ApproximateTopDocuments SearchServer::FindTopImpactOrdered(const ResolvedQuery& query, Predicate document_predicate, const SearchBudget& budget, const Scorer& scorer) const {
+    ApproximateTopDocuments result;
+    const std::vector<ResolvedTerm> terms = GetScoringTerms(query);
+
+    std::vector<ImpactCursor> heap;
+    heap.reserve(terms.size());
+    for (const ResolvedTerm& term : terms) {
+        const ImpactList& impacts = word_to_impacts_.at(term.word);
+        result.postings_total += impacts.size();
+        if (!impacts.empty()) {
+            heap.push_back({impacts.begin(), impacts.end(), term.weight});
+        }
+    }
+    const auto impact_less = [&scorer](const ImpactCursor& lhs, const ImpactCursor& rhs) {
+        return lhs.GetImpact(scorer) < rhs.GetImpact(scorer);
+    };
+    std::make_heap(heap.begin(), heap.end(), impact_less);
+
+    const auto start_time = SearchControl::Clock::now();
+    const bool has_time_limit = budget.max_time != std::chrono::nanoseconds::max();
+    QueryArena arena;
+    std::pmr::map<int, double> document_to_relevance(arena.GetResource());
+    bool is_stopped = false;
+    while (!heap.empty()) {
+        if (result.postings_processed >= budget.max_postings
+            || (has_time_limit && result.postings_processed % SearchControl::CHECK_INTERVAL == 0
+                && SearchControl::Clock::now() - start_time >= budget.max_time)) {
+            is_stopped = true;
+            break;
+        }
+        std::pop_heap(heap.begin(), heap.end(), impact_less);
+        ImpactCursor& cursor = heap.back();
+        const auto [term_freq, document_id] = *cursor.it;
+        ++result.postings_processed;
+
+        const auto& document_data = documents_.at(document_id);
+        if (document_predicate(document_id, document_data.status, document_data.rating)) {
+            document_to_relevance[document_id] += scorer.Score(term_freq, document_data.word_count, cursor.weight);
+        }
+        if (++cursor.it == cursor.end) {
+            heap.pop_back();
+        } else {
+            std::push_heap(heap.begin(), heap.end(), impact_less);
+        }
+    }
+
+    if (is_stopped) {
+        // вклад, который ещё может получить любой документ
+        double remaining_bound = 0.0;
+        for (const ImpactCursor& cursor : heap) {
+            remaining_bound += cursor.GetImpact(scorer);
+        }
+        RefineTopDocuments(query, terms, document_to_relevance, remaining_bound, budget.max_refinements, result);
+        return result;
+    }
+
+    for (const ResolvedTerm& term : query.minus_terms) {
+        for (const auto [document_id, _] : *term.postings) {
+            document_to_relevance.erase(document_id);
+        }
+    }
+    for (const auto [document_id, relevance] : document_to_relevance) {
+        result.documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+    }
+    SelectTopDocuments(std::execution::seq, result.documents, MAX_RESULT_DOCUMENT_COUNT);
+    result.is_exact = true;
+    return result;
+}
+
+template <typename ExecutionPolicy, typename Predicate>
+SearchPage SearchServer::FindTopDocumentsPage(const ExecutionPolicy& policy, const std::string_view raw_query, Predicate document_predicate, const PageRequest& page) const {
+    const ResolvedQuery query = ResolveQuery(ParseQuery(policy, raw_query));
+    return FindPageResolved(policy, query, document_predicate, page);
+}
+
+template <typename ExecutionPolicy>
+SearchPage SearchServer::FindTopDocumentsPage(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status, const PageRequest& page) const {
+    return FindTopDocumentsPage(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+                        return document_status == status;
+                    }, page);
+}
+
+template <typename ExecutionPolicy>
+SearchPage SearchServer::FindTopDocumentsPage(const ExecutionPolicy& policy, const std::string_view raw_query, const PageRequest& page) const {
+    return FindTopDocumentsPage(policy, raw_query, DocumentStatus::ACTUAL, page);
+}
+
+template <typename ExecutionPolicy, typename Predicate>
+SearchPage SearchServer::FindTopDocumentsPage(const ExecutionPolicy& policy, const PreparedQuery& query, Predicate document_predicate, const PageRequest& page) const {
+    ResolvedQuery scratch;
+    return FindPageResolved(policy, GetResolvedQuery(query, scratch), document_predicate, page);
+}
+
+template <typename ExecutionPolicy>
+SearchPage SearchServer::FindTopDocumentsPage(const ExecutionPolicy& policy, const PreparedQuery& query, DocumentStatus status, const PageRequest& page) const {
+    return FindTopDocumentsPage(policy, query, [status](int document_id, DocumentStatus document_status, int rating) {
+                        return document_status == status;
+                    }, page);
+}
+
+template <typename ExecutionPolicy>
+SearchPage SearchServer::FindTopDocumentsPage(const ExecutionPolicy& policy, const PreparedQuery& query, const PageRequest& page) const {
+    return FindTopDocumentsPage(policy, query, DocumentStatus::ACTUAL, page);
+}
+
+inline bool SearchServer::IsRankedBefore(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) >= EPSILON) {
+        return lhs.relevance > rhs.relevance;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::SelectTopDocuments(const ExecutionPolicy& policy, std::vector<Document>& documents, size_t count) {
+    if (documents.size() > count) {
+        std::partial_sort(policy, documents.begin(), documents.begin() + count, documents.end(), IsRankedBefore);
+        documents.resize(count);
+    } else {
+        std::sort(policy, documents.begin(), documents.end(), IsRankedBefore);
+    }
+}
+
+template <typename ExecutionPolicy, typename Iterator, typename Function>
+void SearchServer::ForEachRethrowing(const ExecutionPolicy& policy, Iterator first, Iterator last, Function function) {
+    std::atomic<bool> has_error{false};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    std::for_each(policy, first, last, [&](auto&& value) {
+        if (has_error.load(std::memory_order_relaxed)) {
+            return;
         }
+        try {
+            function(value);
+        } catch (...) {
+            std::lock_guard lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+                has_error.store(true, std::memory_order_relaxed);
+            }
+        }
+    });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+template <typename ExecutionPolicy, typename Predicate>
+SearchPage SearchServer::FindPageResolved(const ExecutionPolicy& policy, const ResolvedQuery& query, Predicate document_predicate, const PageRequest& page) const {
+    SearchPage result;
+    std::vector<Document> documents = FindMatchedDocuments(policy, query, document_predicate);
+    result.matched_documents = documents.size();
+
+    if (page.search_after) {
+        const Document cursor(page.search_after->document_id, page.search_after->relevance, page.search_after->rating);
+        documents.erase(std::remove_if(documents.begin(), documents.end(), [&cursor](const Document& document) {
+                            return !IsRankedBefore(cursor, document);
+                        }),
+                        documents.end());
+    }
+
+    const size_t offset = std::min(page.offset, documents.size());
+    const size_t page_end = offset + std::min(page.limit, documents.size() - offset);
+    const bool has_more = documents.size() > page_end;
 
-        const double inverse_document_freq =
-                     ComputeWordInverseDocumentFreq(word);
+    SelectTopDocuments(policy, documents, page_end);
+    documents.erase(documents.begin(), documents.begin() + offset);
 
-        for (const auto [document_id, term_freq] :
-             word_to_document_freqs_.at(word)) {
+    if (has_more && !documents.empty()) {
+        const Document& last = documents.back();
+        result.next_cursor = SearchCursor{last.relevance, last.rating, last.id};
+    }
+    result.documents = std::move(documents);
+    return result;
+}
+
+template <typename ExecutionPolicy, typename Predicate>
+std::vector<Document> SearchServer::ExplainTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, Predicate document_predicate, SearchStats& stats) const {
+    stats = SearchStats{};
+    SearchStageTimer total_timer(&stats);
+    SearchStageTimer timer(&stats);
+
+    const ResolvedQuery query = ResolveQuery(ParseQuery(policy, raw_query));
+    stats.plus_terms = query.plus_terms.size() + query.expanded_terms.size();
+    stats.minus_terms = query.minus_terms.size();
+    timer.Finish(&SearchStats::parse_time);
+
+    auto result = FindTopResolved(policy, query, document_predicate, &stats);
+    total_timer.Finish(&SearchStats::total_time);
+    return result;
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::ExplainTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status, SearchStats& stats) const {
+    return ExplainTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+                        return document_status == status;
+                    }, stats);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::ExplainTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, SearchStats& stats) const {
+    return ExplainTopDocuments(policy, raw_query, DocumentStatus::ACTUAL, stats);
+}
+
+template <typename ExecutionPolicy, typename Predicate>
+std::vector<Document> SearchServer::FindMatchedDocuments(const ExecutionPolicy& policy, const ResolvedQuery& query, Predicate document_predicate, SearchStats* stats, const SearchControl* control) const {
+    std::vector<Document> matched_documents;
+    {
+        TRACE_SCOPE("FindAllDocuments");
+        matched_documents = VisitScorer(query.average_document_length, [&](const auto& scorer) {
+            return FindAllDocuments(policy, query, document_predicate, scorer, stats, control);
+        });
+    }
+    if (!fuzzy_options_ || query.unmatched_words.empty() || query.has_unmatched_required_words
+        || matched_documents.size() >= fuzzy_options_->min_results
+        || (control != nullptr && control->ShouldStop())) {
+        return matched_documents;
+    }
+
+    TRACE_SCOPE("FuzzyFallback");
+    SearchStageTimer timer(stats);
+    const ResolvedQuery fuzzy_query = ResolveFuzzy(query);
+    const size_t fuzzy_term_count = fuzzy_query.expanded_terms.size() - query.expanded_terms.size();
+    if (stats != nullptr) {
+        for (size_t i = query.expanded_terms.size(); i < fuzzy_query.expanded_terms.size(); ++i) {
+            stats->fuzzy_expansions += fuzzy_query.expanded_terms[i].expansions.size();
+        }
+    }
+    timer.Finish(&SearchStats::fuzzy_time);
+    if (fuzzy_term_count == 0) {
+        return matched_documents;
+    }
+    if (stats != nullptr) {
+        // счётчики документов описывают проход, чьи результаты возвращаются
+        stats->postings_traversed = 0;
+        stats->predicate_rejections = 0;
+        stats->minus_postings_traversed = 0;
+        stats->candidates_removed = 0;
+    }
+    return VisitScorer(fuzzy_query.average_document_length, [&](const auto& scorer) {
+        return FindAllDocuments(policy, fuzzy_query, document_predicate, scorer, stats, control);
+    });
+}
+
+template <typename ExecutionPolicy, typename Predicate>
+std::vector<Document> SearchServer::FindTopResolved(const ExecutionPolicy& policy, const ResolvedQuery& query, Predicate document_predicate, SearchStats* stats, const SearchControl* control) const {
+    std::vector<Document> matched_documents = FindMatchedDocuments(policy, query, document_predicate, stats, control);
+
+    TRACE_SCOPE("SortDocuments");
+    SearchStageTimer timer(stats);
+    if (stats != nullptr) {
+        stats->candidates_sorted += matched_documents.size();
+    }
+    SelectTopDocuments(policy, matched_documents, MAX_RESULT_DOCUMENT_COUNT);
+    if (stats != nullptr) {
+        stats->results += matched_documents.size();
+    }
+    timer.Finish(&SearchStats::sort_time);
+
+    return matched_documents;
+}
+
+template <typename ExecutionPolicy>
+std::vector<std::vector<Document>>
+SearchServer::FindTopDocumentsBatch(const ExecutionPolicy& policy, const std::vector<std::string>& raw_queries, DocumentStatus status) const {
+    TRACE_SCOPE("FindTopDocumentsBatch");
+    // некорректный запрос бросает std::invalid_argument, как FindTopDocuments
+    std::vector<Query> parsed_queries(raw_queries.size());
+    std::vector<size_t> query_indices(raw_queries.size());
+    std::iota(query_indices.begin(), query_indices.end(), 0);
+    ForEachRethrowing(policy, query_indices.begin(), query_indices.end(), [&](size_t index) {
+        parsed_queries[index] = ParseQuery(std::execution::seq, raw_queries[index]);
+    });
+
+    std::vector<ResolvedTerm> terms;
+    std::vector<BatchQuery> batch_queries;
+    std::vector<size_t> single_queries;
+    PrepareBatch(parsed_queries, terms, batch_queries, single_queries);
+
+    std::vector<std::vector<Document>> results(raw_queries.size());
+    ForEachRethrowing(policy, single_queries.begin(), single_queries.end(), [&](size_t index) {
+        results[index] = FindTopDocuments(std::execution::seq, raw_queries[index], status);
+    });
+
+    // параллельно обрабатываются группы, поэтому их должно хватить на все потоки
+    size_t group_size = BATCH_GROUP_SIZE;
+    if constexpr (!std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+        const size_t group_count = 4 * std::max(1u, std::thread::hardware_concurrency());
+        group_size = std::clamp<size_t>((batch_queries.size() + group_count - 1) / group_count, 1, BATCH_GROUP_SIZE);
+    }
+    std::vector<size_t> group_starts;
+    for (size_t start = 0; start < batch_queries.size(); start += group_size) {
+        group_starts.push_back(start);
+    }
+    ForEachRethrowing(policy, group_starts.begin(), group_starts.end(), [&](size_t start) {
+        FindBatchGroup(terms, batch_queries.data() + start, std::min(group_size, batch_queries.size() - start),
+                       raw_queries, status, results);
+    });
+    return results;
+}
+
+// FindAllDocuments
+template <typename Predicate, typename Scorer>
+std::vector<Document>
+SearchServer::FindAllDocuments(const ResolvedQuery& query,
+                               Predicate document_predicate,
+                               const Scorer& scorer,
+                               SearchStats* stats,
+                               const SearchControl* control) const {
+    if (!query.required_terms.empty() || query.has_unmatched_required_words) {
+        return FindRequiredDocuments(query, document_predicate, scorer, stats, control);
+    }
+
+    SearchStageTimer timer(stats);
+    QueryArena arena;
+    std::pmr::map<int, double> document_to_relevance(arena.GetResource());
+    size_t postings_traversed = 0;
+    size_t predicate_rejections = 0;
+    size_t poll_counter = 0;
+    bool is_stopped = false;
+
+    for (const ResolvedTerm& term : query.plus_terms) {
+        if (is_stopped) {
+            break;
+        }
+        for (const auto [document_id, term_freq] : *term.postings) {
+            if (control != nullptr && control->Poll(poll_counter)) {
+                is_stopped = true;
+                break;
+            }
+            ++postings_traversed;
             const auto& document_data =
                 documents_.at(document_id);
             if (document_predicate(document_id,
                 document_data.status,
                 document_data.rating)) {
                 document_to_relevance[document_id] +=
-                    term_freq * inverse_document_freq;
+                    scorer.Score(term_freq, document_data.word_count, term.weight);
+            } else {
+                ++predicate_rejections;
             }
         }
     }
 
-    for (const std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+    // слово-префикс - один поток документов с уже подсчитанным вкладом всех раскрытых слов
+    for (const ExpandedTerm& term : query.expanded_terms) {
+        if (is_stopped) {
+            break;
         }
-
-        for (const auto [document_id, _] :
-            word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
+        for (const auto& [document_id, relevance] : term.postings) {
+            if (control != nullptr && control->Poll(poll_counter)) {
+                is_stopped = true;
+                break;
+            }
+            ++postings_traversed;
+            const auto& document_data =
+                documents_.at(document_id);
+            if (document_predicate(document_id,
+                document_data.status,
+                document_data.rating)) {
+                document_to_relevance[document_id] += relevance;
+            } else {
+                ++predicate_rejections;
+            }
+        }
+    }
+    timer.Finish(&SearchStats::score_time);
+
+    size_t minus_postings_traversed = 0;
+    size_t candidates_removed = 0;
+    for (const ResolvedTerm& term : query.minus_terms) {
+        minus_postings_traversed += term.postings->size();
+        for (const auto [document_id, _] : *term.postings) {
+            candidates_removed += document_to_relevance.erase(document_id);
         }
     }
 
@@ -276,64 +1218,244 @@ SearchServer::FindAllDocuments(const Query& query,
             { document_id, relevance,
               documents_.at(document_id).rating });
     }
+    timer.Finish(&SearchStats::minus_time);
+
+    if (stats != nullptr) {
+        stats->postings_traversed += postings_traversed;
+        stats->predicate_rejections += predicate_rejections;
+        stats->minus_postings_traversed += minus_postings_traversed;
+        stats->candidates_removed += candidates_removed;
+    }
 
     return matched_documents;
 }
 
+template <typename Iterator>
+Iterator SearchServer::GallopTo(Iterator first, Iterator last, int document_id) {
+    const size_t size = last - first;
+    size_t low = 0;
+    size_t high = 1;
+    while (high < size && first[high].first < document_id) {
+        low = high;
+        high *= 2;
+    }
+    return std::lower_bound(first + low, first + std::min(high + 1, size), document_id,
+                            [](const auto& posting, int id) {
+                                return posting.first < id;
+                            });
+}
+
+template <typename Predicate, typename Scorer>
+std::vector<Document> SearchServer::FindRequiredDocuments(const ResolvedQuery& query, Predicate document_predicate, const Scorer& scorer, SearchStats* stats, const SearchControl* control) const {
+    SearchStageTimer timer(stats);
+    std::vector<Document> matched_documents;
+    if (query.has_unmatched_required_words) {
+        return matched_documents;
+    }
+
+    std::vector<PostingCursor> plus_cursors;
+    plus_cursors.reserve(query.plus_terms.size());
+    for (const ResolvedTerm& term : query.plus_terms) {
+        plus_cursors.push_back({term.postings, term.postings->begin()});
+    }
+    // курсоры обязательных слов - те же, что у плюс-слов, поэтому при подсчёте
+    // релевантности они уже стоят на документе
+    std::vector<PostingCursor*> required_cursors;
+    for (const ResolvedTerm& term : query.required_terms) {
+        const auto it = std::lower_bound(query.plus_terms.begin(), query.plus_terms.end(), term.word,
+                                         [](const ResolvedTerm& plus_term, std::string_view word) {
+                                             return plus_term.word < word;
+                                         });
+        required_cursors.push_back(&plus_cursors[it - query.plus_terms.begin()]);
+    }
+    std::sort(required_cursors.begin(), required_cursors.end(), [](const PostingCursor* lhs, const PostingCursor* rhs) {
+        return lhs->postings->size() < rhs->postings->size();
+    });
+    std::vector<PostingCursor> minus_cursors;
+    minus_cursors.reserve(query.minus_terms.size());
+    for (const ResolvedTerm& term : query.minus_terms) {
+        minus_cursors.push_back({term.postings, term.postings->begin()});
+    }
+    using ExpandedIterator = std::vector<std::pair<int, double>>::const_iterator;
+    std::vector<ExpandedIterator> expanded_its;
+    expanded_its.reserve(query.expanded_terms.size());
+    for (const ExpandedTerm& term : query.expanded_terms) {
+        expanded_its.push_back(term.postings.begin());
+    }
+
+    size_t postings_traversed = 0;
+    size_t predicate_rejections = 0;
+    size_t minus_postings_traversed = 0;
+    size_t candidates_removed = 0;
+    size_t poll_counter = 0;
+    PostingCursor& lead = *required_cursors.front();
+    bool is_exhausted = false;
+    while (!is_exhausted && lead.it != lead.postings->end()) {
+        if (control != nullptr && control->Poll(poll_counter)) {
+            break;
+        }
+        const int document_id = lead.it->first;
+        ++postings_traversed;
+
+        // при промахе самый короткий список перескакивает к документу, на котором остановился длинный
+        bool has_all_required = true;
+        for (size_t i = 1; i < required_cursors.size(); ++i) {
+            PostingCursor& cursor = *required_cursors[i];
+            ++postings_traversed;
+            if (cursor.Seek(document_id)) {
+                continue;
+            }
+            has_all_required = false;
+            if (cursor.it == cursor.postings->end()) {
+                is_exhausted = true;
+            } else {
+                lead.Seek(cursor.it->first);
+            }
+            break;
+        }
+        if (!has_all_required) {
+            continue;
+        }
+
+        const DocumentData& document_data = documents_.at(document_id);
+        if (!document_predicate(document_id, document_data.status, document_data.rating)) {
+            ++predicate_rejections;
+            ++lead.it;
+            continue;
+        }
+        minus_postings_traversed += minus_cursors.size();
+        if (std::any_of(minus_cursors.begin(), minus_cursors.end(), [document_id](PostingCursor& cursor) {
+                return cursor.Seek(document_id);
+            })) {
+            ++candidates_removed;
+            ++lead.it;
+            continue;
+        }
+
+        // в том же порядке, что и FindAllDocuments без обязательных слов
+        double relevance = 0.0;
+        for (size_t i = 0; i < plus_cursors.size(); ++i) {
+            if (plus_cursors[i].Seek(document_id)) {
+                relevance += scorer.Score(plus_cursors[i].it->second, document_data.word_count, query.plus_terms[i].weight);
+            }
+        }
+        for (size_t i = 0; i < expanded_its.size(); ++i) {
+            const auto end = query.expanded_terms[i].postings.end();
+            expanded_its[i] = GallopTo(expanded_its[i], end, document_id);
+            if (expanded_its[i] != end && expanded_its[i]->first == document_id) {
+                relevance += expanded_its[i]->second;
+            }
+        }
+        postings_traversed += plus_cursors.size() - required_cursors.size() + expanded_its.size();
+        matched_documents.push_back({document_id, relevance, document_data.rating});
+        ++lead.it;
+    }
+    timer.Finish(&SearchStats::score_time);
+
+    if (stats != nullptr) {
+        stats->postings_traversed += postings_traversed;
+        stats->predicate_rejections += predicate_rejections;
+        stats->minus_postings_traversed += minus_postings_traversed;
+        stats->candidates_removed += candidates_removed;
+    }
+    return matched_documents;
+}
+
 // FindAllDocuments sequenced_policy
-template <typename Predicate>
+template <typename Predicate, typename Scorer>
 std::vector<Document>
 SearchServer::FindAllDocuments(
               const std::execution::sequenced_policy& policy,
-              const Query& query,
-              Predicate document_predicate) const {
-    return FindAllDocuments(query, document_predicate);
+              const ResolvedQuery& query,
+              Predicate document_predicate,
+              const Scorer& scorer,
+              SearchStats* stats,
+              const SearchControl* control) const {
+    return FindAllDocuments(query, document_predicate, scorer, stats, control);
 }
 
 // FindAllDocuments parallel_policy
-template <typename Predicate>
+template <typename Predicate, typename Scorer>
 std::vector<Document>
 SearchServer::FindAllDocuments(
               const std::execution::parallel_policy& policy,
-              const Query& query,
-              Predicate document_predicate) const {
+              const ResolvedQuery& query,
+              Predicate document_predicate,
+              const Scorer& scorer,
+              SearchStats* stats,
+              const SearchControl* control) const {
+    // пересечение обходит лишь малую часть списков, делить его между потоками не нужно
+    if (!query.required_terms.empty() || query.has_unmatched_required_words) {
+        return FindRequiredDocuments(query, document_predicate, scorer, stats, control);
+    }
+
+    SearchStageTimer timer(stats);
     ConcurrentMap<int, double> relevances(MAP_BUCKETS);
+    std::atomic<size_t> predicate_rejections = 0;
+    std::atomic<size_t> candidates_removed = 0;
 
     for_each (policy,
-              query.plus_words.begin(),
-              query.plus_words.end(),
-              [this, &relevances, &document_predicate]
-              (std::string_view word) {
-                  if (word_to_document_freqs_.count(word) == 0) {
+              query.plus_terms.begin(),
+              query.plus_terms.end(),
+              [this, &relevances, &document_predicate, &scorer, &predicate_rejections, control]
+              (const ResolvedTerm& term) {
+                  if (control != nullptr && control->ShouldStop()) {
                       return;
                   }
-                  const double
-                  idf = ComputeWordInverseDocumentFreq(word);
-
-                  for (const auto& [id, freq]
-                       : word_to_document_freqs_.at(word)) {
+                  size_t term_rejections = 0;
+                  size_t poll_counter = 0;
+                  for (const auto& [id, freq] : *term.postings) {
+                      if (control != nullptr && control->Poll(poll_counter)) {
+                          break;
+                      }
                       const DocumentData doc = documents_.at(id);
                       if (document_predicate(id, doc.status,
                                              doc.rating)) {
                           relevances[id].ref_to_value +=
-                              freq * idf;
+                              scorer.Score(freq, doc.word_count, term.weight);
+                      } else {
+                          ++term_rejections;
                       }
                   }
+                  predicate_rejections += term_rejections;
               });
 
     for_each (policy,
-              query.minus_words.begin(),
-              query.minus_words.end(),
-              [this, &relevances]
-              (std::string_view word) {
-                  if (word_to_document_freqs_.count(word) == 0) {
+              query.expanded_terms.begin(),
+              query.expanded_terms.end(),
+              [this, &relevances, &document_predicate, &predicate_rejections, control]
+              (const ExpandedTerm& term) {
+                  if (control != nullptr && control->ShouldStop()) {
                       return;
                   }
+                  size_t term_rejections = 0;
+                  size_t poll_counter = 0;
+                  for (const auto& [id, relevance] : term.postings) {
+                      if (control != nullptr && control->Poll(poll_counter)) {
+                          break;
+                      }
+                      const DocumentData doc = documents_.at(id);
+                      if (document_predicate(id, doc.status,
+                                             doc.rating)) {
+                          relevances[id].ref_to_value += relevance;
+                      } else {
+                          ++term_rejections;
+                      }
+                  }
+                  predicate_rejections += term_rejections;
+              });
+    timer.Finish(&SearchStats::score_time);
 
-                  for (const auto& [id, _]
-                       : word_to_document_freqs_.at(word)) {
-                      relevances.Erase(id);
+    for_each (policy,
+              query.minus_terms.begin(),
+              query.minus_terms.end(),
+              [&relevances, &candidates_removed]
+              (const ResolvedTerm& term) {
+                  size_t term_removed = 0;
+                  for (const auto& [id, _] : *term.postings) {
+                      term_removed += relevances.Erase(id);
                   }
+                  candidates_removed += term_removed;
               });
 
     std::vector<Document> matched_documents;
@@ -343,6 +1465,21 @@ SearchServer::FindAllDocuments(
             { id, relevance,
               documents_.at(id).rating });
     }
+    timer.Finish(&SearchStats::minus_time);
+
+    if (stats != nullptr) {
+        for (const ResolvedTerm& term : query.plus_terms) {
+            stats->postings_traversed += term.postings->size();
+        }
+        for (const ExpandedTerm& term : query.expanded_terms) {
+            stats->postings_traversed += term.postings.size();
+        }
+        for (const ResolvedTerm& term : query.minus_terms) {
+            stats->minus_postings_traversed += term.postings->size();
+        }
+        stats->predicate_rejections += predicate_rejections;
+        stats->candidates_removed += candidates_removed;
+    }
 
     return matched_documents;
 }
@@ -350,15 +1487,15 @@ SearchServer::FindAllDocuments(
 
 template <typename Policy>
 void SearchServer::RemoveDocument(Policy policy, const int document_id){
-    if (document_ids_.find(document_id) != document_ids_.end()) {
+    if (document_ids_.find(document_id) == document_ids_.end()) {
              return;
     }
 
-    std::vector<const std::string*> words_to_delete(document_ids_with_word_.at(document_id).size());
+    std::vector<const std::string_view*> words_to_delete(document_ids_with_word_.at(document_id).size());
     std::transform(policy,
                    document_ids_with_word_.at(document_id).cbegin(), document_ids_with_word_.at(document_id).cend(),
                    words_to_delete.begin(),
-                    [] (const std::pair<const std::string, double>& words_freq) {
+                    [] (const std::pair<const std::string_view, double>& words_freq) {
                      return &words_freq.first;
                     }
     );
@@ -367,9 +1504,15 @@ void SearchServer::RemoveDocument(Policy policy, const int document_id){
                   words_to_delete.cbegin(), words_to_delete.cend(),
                   [this, document_id] (const auto& word) {
          word_to_document_freqs_.at(*word).erase(document_id);
+         if (has_impact_index_) {
+             word_to_impacts_.at(*word).erase({document_ids_with_word_.at(document_id).at(*word), document_id});
+         }
     });
+    RemoveFromResultCache(document_id);
 
+    total_word_count_ -= documents_.at(document_id).word_count;
     document_ids_.erase(document_id);
     document_ids_with_word_.erase(document_id);
     documents_.erase(document_id);
+    ++index_version_;
 }
@@ -0,0 +1,21 @@
+#include "search_stats.h"
+
+std::ostream& operator<<(std::ostream& out, const SearchStats& stats) {
+    out << "{ "
+        << "plus_terms = " << stats.plus_terms << ", "
+        << "minus_terms = " << stats.minus_terms << ", "
+        << "postings_traversed = " << stats.postings_traversed << ", "
+        << "predicate_rejections = " << stats.predicate_rejections << ", "
+        << "minus_postings_traversed = " << stats.minus_postings_traversed << ", "
+        << "candidates_removed = " << stats.candidates_removed << ", "
+        << "candidates_sorted = " << stats.candidates_sorted << ", "
+        << "results = " << stats.results << ", "
+        << "fuzzy_expansions = " << stats.fuzzy_expansions << ", "
+        << "parse_ns = " << stats.parse_time.count() << ", "
+        << "score_ns = " << stats.score_time.count() << ", "
+        << "minus_ns = " << stats.minus_time.count() << ", "
+        << "fuzzy_ns = " << stats.fuzzy_time.count() << ", "
+        << "sort_ns = " << stats.sort_time.count() << ", "
+        << "total_ns = " << stats.total_time.count() << " }";
+    return out;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+
+/**
+ * Счётчики и время этапов одного поиска (см. SearchServer::ExplainTopDocuments).
+ * Сбор стоит несколько чтений часов на запрос, поэтому его можно
+ * включать для выборки запросов в рабочем режиме.
+ * Если сработал поиск с опечатками, счётчики документов относятся
+ * к повторному проходу, а время этапов - сумма обоих проходов.
+ */
+struct SearchStats {
+    // слова запроса, найденные в индексе
+    size_t plus_terms = 0;
+    size_t minus_terms = 0;
+    // документы из списков плюс-слов, просмотренные при подсчёте релевантности
+    size_t postings_traversed = 0;
+    size_t predicate_rejections = 0;
+    // документы из списков минус-слов
+    size_t minus_postings_traversed = 0;
+    size_t candidates_removed = 0;
+    size_t candidates_sorted = 0;
+    size_t results = 0;
+    // слова словаря, подставленные вместо слов с опечатками
+    size_t fuzzy_expansions = 0;
+
+    std::chrono::nanoseconds parse_time{0};
+    std::chrono::nanoseconds score_time{0};
+    std::chrono::nanoseconds minus_time{0};
+    std::chrono::nanoseconds fuzzy_time{0};
+    std::chrono::nanoseconds sort_time{0};
+    std::chrono::nanoseconds total_time{0};
+};
+
+std::ostream& operator<<(std::ostream& out, const SearchStats& stats);
+
+// засекает этапы поиска; без SearchStats не обращается к часам
+class SearchStageTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit SearchStageTimer(SearchStats* stats)
+        : stats_(stats) {
+        if (stats_ != nullptr) {
+            stage_start_ = Clock::now();
+        }
+    }
+
+    // прибавляет время с начала этапа к полю stage и начинает следующий этап
+    void Finish(std::chrono::nanoseconds SearchStats::* stage) {
+        if (stats_ != nullptr) {
+            const auto now = Clock::now();
+            stats_->*stage += now - stage_start_;
+            stage_start_ = now;
+        }
+    }
+
+private:
+    SearchStats* stats_;
+    Clock::time_point stage_start_;
+};
@@ -0,0 +1,195 @@
+#include "shard_aggregator.h"
+#include "search_server.h"
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+
+ShardAggregator::ShardAggregator(const std::vector<std::string>& addresses, std::chrono::milliseconds shard_timeout)
+    : shard_timeout_(shard_timeout) {
+    if (addresses.empty()) {
+        throw std::invalid_argument("No shard addresses");
+    }
+    for (const std::string& address : addresses) {
+        shards_.push_back({address, -1, {}});
+    }
+}
+
+ShardAggregator::~ShardAggregator() {
+    for (Shard& shard : shards_) {
+        Disconnect(shard);
+    }
+}
+
+void ShardAggregator::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    if (document_id < 0) {
+        throw std::invalid_argument("Invalid document_id");
+    }
+    const size_t shard_index = static_cast<size_t>(document_id) % shards_.size();
+    const std::string payload = EncodeAddDocument({document_id, std::string(document), status, ratings});
+    const auto replies = Exchange({shard_index}, ShardMessageType::ADD_DOCUMENT, payload);
+
+    if (!replies[0]) {
+        throw std::runtime_error("Shard " + shards_[shard_index].address + " did not respond");
+    }
+    if (replies[0]->type == ShardMessageType::ERROR) {
+        throw std::invalid_argument(replies[0]->payload);
+    }
+}
+
+ShardedSearchResult ShardAggregator::FindTopDocuments(std::string_view raw_query, DocumentStatus status) {
+    ShardedSearchResult result;
+    std::vector<size_t> all_shards(shards_.size());
+    for (size_t i = 0; i < all_shards.size(); ++i) {
+        all_shards[i] = i;
+    }
+
+    // первый круг: документные частоты слов запроса на каждом шарде
+    PayloadWriter query_writer;
+    query_writer.WriteString(raw_query);
+    const auto statistics_replies = Exchange(all_shards, ShardMessageType::TERM_STATISTICS, query_writer.GetData());
+
+    // ошибку прислали все ответившие шарды - некорректен сам запрос, а не шарды
+    const auto is_error = [](const std::optional<ShardFrame>& reply) {
+        return reply && reply->type == ShardMessageType::ERROR;
+    };
+    const auto first_error = std::find_if(statistics_replies.begin(), statistics_replies.end(), is_error);
+    if (first_error != statistics_replies.end()
+        && std::all_of(statistics_replies.begin(), statistics_replies.end(), [&is_error](const auto& reply) {
+               return !reply || is_error(reply);
+           })) {
+        throw std::invalid_argument((*first_error)->payload);
+    }
+
+    ShardSearchRequest request;
+    request.raw_query = std::string(raw_query);
+    request.status = status;
+    std::vector<size_t> search_shards;
+    for (size_t i = 0; i < all_shards.size(); ++i) {
+        const auto& reply = statistics_replies[i];
+        if (!reply || reply->type != ShardMessageType::TERM_STATISTICS_REPLY) {
+            result.failed_shards.push_back(all_shards[i]);
+            continue;
+        }
+        request.statistics.Add(DecodeTermStatistics(reply->payload));
+        search_shards.push_back(all_shards[i]);
+    }
+
+    // второй круг: поиск с общей статистикой
+    const auto search_replies = Exchange(search_shards, ShardMessageType::SEARCH, EncodeSearchRequest(request));
+    for (size_t i = 0; i < search_shards.size(); ++i) {
+        const auto& reply = search_replies[i];
+        if (!reply || reply->type != ShardMessageType::SEARCH_REPLY) {
+            result.failed_shards.push_back(search_shards[i]);
+            continue;
+        }
+        const std::vector<Document> documents = DecodeDocuments(reply->payload);
+        result.documents.insert(result.documents.end(), documents.begin(), documents.end());
+    }
+
+    // каждый шард прислал свои лучшие документы, общий топ - лучшие из них
+    const size_t count = std::min<size_t>(result.documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+    std::partial_sort(result.documents.begin(), result.documents.begin() + count, result.documents.end(),
+                      SearchServer::IsRankedBefore);
+    result.documents.resize(count);
+    std::sort(result.failed_shards.begin(), result.failed_shards.end());
+    return result;
+}
+
+std::vector<std::optional<ShardFrame>> ShardAggregator::Exchange(const std::vector<size_t>& shard_indexes,
+                                                                 ShardMessageType type,
+                                                                 const std::string& payload) {
+    using Clock = std::chrono::steady_clock;
+    const auto deadline = Clock::now() + shard_timeout_;
+    const uint32_t request_id = next_request_id_++;
+    const std::string frame = EncodeFrame({type, request_id, payload});
+
+    std::vector<std::optional<ShardFrame>> replies(shard_indexes.size());
+    // позиции в shard_indexes, от которых ещё ждём ответа
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < shard_indexes.size(); ++i) {
+        Shard& shard = shards_[shard_indexes[i]];
+        if (!EnsureConnected(shard)) {
+            continue;
+        }
+        try {
+            SendAll(shard.fd, frame);
+            pending.push_back(i);
+        } catch (const std::system_error&) {
+            Disconnect(shard);
+        }
+    }
+
+    std::vector<pollfd> poll_fds;
+    while (!pending.empty()) {
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+        if (remaining.count() <= 0) {
+            break;
+        }
+        poll_fds.clear();
+        for (const size_t i : pending) {
+            poll_fds.push_back({shards_[shard_indexes[i]].fd, POLLIN, 0});
+        }
+        if (poll(poll_fds.data(), poll_fds.size(), static_cast<int>(remaining.count())) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "poll");
+        }
+
+        std::vector<size_t> still_pending;
+        for (size_t j = 0; j < pending.size(); ++j) {
+            const size_t i = pending[j];
+            Shard& shard = shards_[shard_indexes[i]];
+            if (poll_fds[j].revents == 0) {
+                still_pending.push_back(i);
+                continue;
+            }
+            try {
+                if (!ReceiveSome(shard.fd, shard.buffer)) {
+                    Disconnect(shard);
+                    continue;
+                }
+                ShardFrame reply;
+                // ответы на прошлые, уже просроченные запросы пропускаются
+                while (!replies[i] && DecodeFrame(shard.buffer, reply)) {
+                    if (reply.request_id == request_id) {
+                        replies[i] = std::move(reply);
+                    }
+                }
+            } catch (const std::exception&) {
+                Disconnect(shard);
+                continue;
+            }
+            if (!replies[i]) {
+                still_pending.push_back(i);
+            }
+        }
+        pending.swap(still_pending);
+    }
+    return replies;
+}
+
+bool ShardAggregator::EnsureConnected(Shard& shard) {
+    if (shard.fd >= 0) {
+        return true;
+    }
+    try {
+        shard.fd = ConnectToAddress(shard.address);
+        shard.buffer.clear();
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+void ShardAggregator::Disconnect(Shard& shard) {
+    if (shard.fd >= 0) {
+        close(shard.fd);
+        shard.fd = -1;
+    }
+    shard.buffer.clear();
+}
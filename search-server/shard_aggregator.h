@@ -0,0 +1,71 @@
+#pragma once
+
+#include "document.h"
+#include "shard_protocol.h"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ShardedSearchResult {
+    std::vector<Document> documents;
+    // шарды, не ответившие вовремя или ответившие ошибкой;
+    // если список не пуст, результат посчитан без их документов
+    std::vector<size_t> failed_shards;
+};
+
+/**
+ * Рассылает запросы нескольким процессам search_shard_server и сливает их
+ * лучшие документы. Поиск идёт в два круга: сначала шарды присылают
+ * документные частоты слов запроса, затем ищут с IDF по их сумме,
+ * поэтому выдача совпадает с выдачей одного общего SearchServer.
+ *
+ * Каждый круг ждёт ответа шардов не дольше shard_timeout.
+ * Объект не потокобезопасен.
+ */
+class ShardAggregator {
+public:
+    ShardAggregator(const std::vector<std::string>& addresses, std::chrono::milliseconds shard_timeout);
+    ~ShardAggregator();
+
+    ShardAggregator(const ShardAggregator&) = delete;
+    ShardAggregator& operator=(const ShardAggregator&) = delete;
+
+    // документ хранится в шарде document_id % GetShardCount()
+    void AddDocument(int document_id,
+                     std::string_view document,
+                     DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    // некорректный запрос (ошибка от всех ответивших шардов) - std::invalid_argument
+    ShardedSearchResult FindTopDocuments(std::string_view raw_query,
+                                         DocumentStatus status = DocumentStatus::ACTUAL);
+
+    size_t GetShardCount() const {
+        return shards_.size();
+    }
+
+private:
+    struct Shard {
+        std::string address;
+        int fd = -1;
+        // принятые байты, ещё не сложившиеся в кадр
+        std::string buffer;
+    };
+
+    // отправляет запрос шардам shard_indexes и ждёт ответов до истечения shard_timeout_;
+    // ответы - по индексу в shard_indexes, пустые для не ответивших
+    std::vector<std::optional<ShardFrame>> Exchange(const std::vector<size_t>& shard_indexes,
+                                                    ShardMessageType type,
+                                                    const std::string& payload);
+
+    bool EnsureConnected(Shard& shard);
+    void Disconnect(Shard& shard);
+
+    std::vector<Shard> shards_;
+    const std::chrono::milliseconds shard_timeout_;
+    uint32_t next_request_id_ = 1;
+};
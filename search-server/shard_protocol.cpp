@@ -0,0 +1,365 @@
+#include "shard_protocol.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+namespace {
+
+const size_t FRAME_HEADER_SIZE = 9;
+// защита от мусора в потоке: больше шард не отправляет
+const uint32_t MAX_FRAME_SIZE = 64 * 1024 * 1024;
+
+void AppendUint32(std::string& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+uint32_t ParseUint32(const char* data) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; --i) {
+        value = (value << 8) | static_cast<unsigned char>(data[i]);
+    }
+    return value;
+}
+
+[[noreturn]] void ThrowSystemError(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+struct SocketAddress {
+    sockaddr_storage storage{};
+    socklen_t size = 0;
+    int family = AF_UNSPEC;
+};
+
+SocketAddress ParseAddress(const std::string& address) {
+    SocketAddress result;
+    const std::string_view text = address;
+    if (text.substr(0, 5) == "unix:") {
+        const std::string_view path = text.substr(5);
+        sockaddr_un unix_address{};
+        if (path.empty() || path.size() >= sizeof(unix_address.sun_path)) {
+            throw std::invalid_argument("Invalid unix socket path: " + address);
+        }
+        unix_address.sun_family = AF_UNIX;
+        std::memcpy(unix_address.sun_path, path.data(), path.size());
+        std::memcpy(&result.storage, &unix_address, sizeof(unix_address));
+        result.size = sizeof(unix_address);
+        result.family = AF_UNIX;
+        return result;
+    }
+    if (text.substr(0, 4) == "tcp:") {
+        const std::string_view host_port = text.substr(4);
+        const size_t colon = host_port.rfind(':');
+        if (colon == std::string_view::npos) {
+            throw std::invalid_argument("Invalid tcp address: " + address);
+        }
+        sockaddr_in inet_address{};
+        inet_address.sin_family = AF_INET;
+        const std::string host(host_port.substr(0, colon));
+        const int port = std::stoi(std::string(host_port.substr(colon + 1)));
+        if (inet_pton(AF_INET, host.c_str(), &inet_address.sin_addr) != 1 || port <= 0 || port > 65535) {
+            throw std::invalid_argument("Invalid tcp address: " + address);
+        }
+        inet_address.sin_port = htons(static_cast<uint16_t>(port));
+        std::memcpy(&result.storage, &inet_address, sizeof(inet_address));
+        result.size = sizeof(inet_address);
+        result.family = AF_INET;
+        return result;
+    }
+    throw std::invalid_argument("Unknown address scheme: " + address);
+}
+
+} // namespace
+
+void PayloadWriter::WriteUint8(uint8_t value) {
+    data_.push_back(static_cast<char>(value));
+}
+
+void PayloadWriter::WriteUint32(uint32_t value) {
+    AppendUint32(data_, value);
+}
+
+void PayloadWriter::WriteInt32(int32_t value) {
+    AppendUint32(data_, static_cast<uint32_t>(value));
+}
+
+void PayloadWriter::WriteUint64(uint64_t value) {
+    AppendUint32(data_, static_cast<uint32_t>(value));
+    AppendUint32(data_, static_cast<uint32_t>(value >> 32));
+}
+
+void PayloadWriter::WriteDouble(double value) {
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    WriteUint64(bits);
+}
+
+void PayloadWriter::WriteString(std::string_view value) {
+    AppendUint32(data_, static_cast<uint32_t>(value.size()));
+    data_.append(value);
+}
+
+std::string_view PayloadReader::Take(size_t size) {
+    if (data_.size() < size) {
+        throw ShardProtocolError("Truncated shard message");
+    }
+    const std::string_view result = data_.substr(0, size);
+    data_.remove_prefix(size);
+    return result;
+}
+
+uint8_t PayloadReader::ReadUint8() {
+    return static_cast<uint8_t>(Take(1)[0]);
+}
+
+uint32_t PayloadReader::ReadUint32() {
+    return ParseUint32(Take(4).data());
+}
+
+int32_t PayloadReader::ReadInt32() {
+    return static_cast<int32_t>(ReadUint32());
+}
+
+uint64_t PayloadReader::ReadUint64() {
+    const uint64_t low = ReadUint32();
+    const uint64_t high = ReadUint32();
+    return low | (high << 32);
+}
+
+double PayloadReader::ReadDouble() {
+    const uint64_t bits = ReadUint64();
+    double value = 0.0;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+std::string_view PayloadReader::ReadString() {
+    const uint32_t size = ReadUint32();
+    return Take(size);
+}
+
+std::string EncodeFrame(const ShardFrame& frame) {
+    std::string result;
+    result.reserve(FRAME_HEADER_SIZE + frame.payload.size());
+    AppendUint32(result, static_cast<uint32_t>(frame.payload.size()));
+    result.push_back(static_cast<char>(frame.type));
+    AppendUint32(result, frame.request_id);
+    result += frame.payload;
+    return result;
+}
+
+bool DecodeFrame(std::string& buffer, ShardFrame& frame) {
+    if (buffer.size() < FRAME_HEADER_SIZE) {
+        return false;
+    }
+    const uint32_t payload_size = ParseUint32(buffer.data());
+    if (payload_size > MAX_FRAME_SIZE) {
+        throw ShardProtocolError("Shard frame is too large");
+    }
+    if (buffer.size() < FRAME_HEADER_SIZE + payload_size) {
+        return false;
+    }
+    frame.type = static_cast<ShardMessageType>(buffer[4]);
+    frame.request_id = ParseUint32(buffer.data() + 5);
+    frame.payload.assign(buffer, FRAME_HEADER_SIZE, payload_size);
+    buffer.erase(0, FRAME_HEADER_SIZE + payload_size);
+    return true;
+}
+
+std::string EncodeAddDocument(const AddDocumentRequest& request) {
+    PayloadWriter writer;
+    writer.WriteInt32(request.document_id);
+    writer.WriteString(request.document);
+    writer.WriteUint8(static_cast<uint8_t>(request.status));
+    writer.WriteUint32(static_cast<uint32_t>(request.ratings.size()));
+    for (const int rating : request.ratings) {
+        writer.WriteInt32(rating);
+    }
+    return std::move(writer.GetData());
+}
+
+AddDocumentRequest DecodeAddDocument(std::string_view payload) {
+    PayloadReader reader(payload);
+    AddDocumentRequest request;
+    request.document_id = reader.ReadInt32();
+    request.document = std::string(reader.ReadString());
+    request.status = static_cast<DocumentStatus>(reader.ReadUint8());
+    const uint32_t rating_count = reader.ReadUint32();
+    for (uint32_t i = 0; i < rating_count; ++i) {
+        request.ratings.push_back(reader.ReadInt32());
+    }
+    return request;
+}
+
+namespace {
+
+void WriteTermStatistics(PayloadWriter& writer, const TermStatistics& statistics) {
+    writer.WriteInt32(statistics.document_count);
+    writer.WriteUint64(static_cast<uint64_t>(statistics.word_count));
+    writer.WriteUint32(static_cast<uint32_t>(statistics.document_freqs.size()));
+    for (const auto& [word, document_freq] : statistics.document_freqs) {
+        writer.WriteString(word);
+        writer.WriteInt32(document_freq);
+    }
+}
+
+TermStatistics ReadTermStatistics(PayloadReader& reader) {
+    TermStatistics statistics;
+    statistics.document_count = reader.ReadInt32();
+    statistics.word_count = static_cast<int64_t>(reader.ReadUint64());
+    const uint32_t word_count = reader.ReadUint32();
+    for (uint32_t i = 0; i < word_count; ++i) {
+        const std::string_view word = reader.ReadString();
+        statistics.document_freqs[std::string(word)] = reader.ReadInt32();
+    }
+    return statistics;
+}
+
+} // namespace
+
+std::string EncodeTermStatistics(const TermStatistics& statistics) {
+    PayloadWriter writer;
+    WriteTermStatistics(writer, statistics);
+    return std::move(writer.GetData());
+}
+
+TermStatistics DecodeTermStatistics(std::string_view payload) {
+    PayloadReader reader(payload);
+    return ReadTermStatistics(reader);
+}
+
+std::string EncodeSearchRequest(const ShardSearchRequest& request) {
+    PayloadWriter writer;
+    writer.WriteString(request.raw_query);
+    writer.WriteUint8(static_cast<uint8_t>(request.status));
+    WriteTermStatistics(writer, request.statistics);
+    return std::move(writer.GetData());
+}
+
+ShardSearchRequest DecodeSearchRequest(std::string_view payload) {
+    PayloadReader reader(payload);
+    ShardSearchRequest request;
+    request.raw_query = std::string(reader.ReadString());
+    request.status = static_cast<DocumentStatus>(reader.ReadUint8());
+    request.statistics = ReadTermStatistics(reader);
+    return request;
+}
+
+std::string EncodeDocuments(const std::vector<Document>& documents) {
+    PayloadWriter writer;
+    writer.WriteUint32(static_cast<uint32_t>(documents.size()));
+    for (const Document& document : documents) {
+        writer.WriteInt32(document.id);
+        writer.WriteDouble(document.relevance);
+        writer.WriteInt32(document.rating);
+    }
+    return std::move(writer.GetData());
+}
+
+std::vector<Document> DecodeDocuments(std::string_view payload) {
+    PayloadReader reader(payload);
+    const uint32_t document_count = reader.ReadUint32();
+    std::vector<Document> documents;
+    documents.reserve(document_count);
+    for (uint32_t i = 0; i < document_count; ++i) {
+        const int id = reader.ReadInt32();
+        const double relevance = reader.ReadDouble();
+        const int rating = reader.ReadInt32();
+        documents.emplace_back(id, relevance, rating);
+    }
+    return documents;
+}
+
+int ListenOnAddress(const std::string& address) {
+    const SocketAddress socket_address = ParseAddress(address);
+    const int fd = socket(socket_address.family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        ThrowSystemError("socket");
+    }
+    if (socket_address.family == AF_UNIX) {
+        unlink(address.c_str() + 5);
+    } else {
+        const int enable = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    }
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&socket_address.storage), socket_address.size) != 0
+        || listen(fd, SOMAXCONN) != 0) {
+        const int error = errno;
+        close(fd);
+        errno = error;
+        ThrowSystemError("listen on " + address);
+    }
+    return fd;
+}
+
+int ConnectToAddress(const std::string& address) {
+    const SocketAddress socket_address = ParseAddress(address);
+    const int fd = socket(socket_address.family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        ThrowSystemError("socket");
+    }
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&socket_address.storage), socket_address.size) != 0) {
+        const int error = errno;
+        close(fd);
+        errno = error;
+        ThrowSystemError("connect to " + address);
+    }
+    if (socket_address.family == AF_INET) {
+        // запросы маленькие, задержка Нейгла им только вредит
+        const int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    }
+    return fd;
+}
+
+int AcceptConnection(int listen_fd) {
+    sockaddr_storage peer{};
+    socklen_t peer_size = sizeof(peer);
+    const int fd = accept4(listen_fd, reinterpret_cast<sockaddr*>(&peer), &peer_size, SOCK_CLOEXEC);
+    if (fd < 0) {
+        ThrowSystemError("accept");
+    }
+    if (peer.ss_family == AF_INET) {
+        const int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    }
+    return fd;
+}
+
+void SendAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("send");
+        }
+        data.remove_prefix(written);
+    }
+}
+
+bool ReceiveSome(int fd, std::string& buffer) {
+    char chunk[64 * 1024];
+    while (true) {
+        const ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("recv");
+        }
+        buffer.append(chunk, received);
+        return received > 0;
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "document.h"
+#include "term_statistics.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Двоичный протокол между ShardAggregator и search_shard_server.
+ * Кадр: длина данных (4 байта) | тип (1 байт) | id запроса (4 байта) | данные.
+ * Числа передаются в little-endian, строки - длиной (4 байта) и байтами.
+ * Ответ несёт id запроса, поэтому опоздавший ответ можно отличить от текущего.
+ */
+enum class ShardMessageType : uint8_t {
+    ADD_DOCUMENT = 1,
+    TERM_STATISTICS = 2,
+    SEARCH = 3,
+
+    OK = 100,
+    ERROR = 101,
+    TERM_STATISTICS_REPLY = 102,
+    SEARCH_REPLY = 103,
+};
+
+struct ShardFrame {
+    ShardMessageType type = ShardMessageType::OK;
+    uint32_t request_id = 0;
+    std::string payload;
+};
+
+// повреждённый или неожиданный кадр
+class ShardProtocolError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+class PayloadWriter {
+public:
+    void WriteUint8(uint8_t value);
+    void WriteUint32(uint32_t value);
+    void WriteInt32(int32_t value);
+    void WriteUint64(uint64_t value);
+    // побитовая копия, чтобы релевантность шарда не округлялась
+    void WriteDouble(double value);
+    void WriteString(std::string_view value);
+
+    std::string& GetData() {
+        return data_;
+    }
+
+private:
+    std::string data_;
+};
+
+class PayloadReader {
+public:
+    explicit PayloadReader(std::string_view data)
+        : data_(data) {
+    }
+
+    uint8_t ReadUint8();
+    uint32_t ReadUint32();
+    int32_t ReadInt32();
+    uint64_t ReadUint64();
+    double ReadDouble();
+    std::string_view ReadString();
+
+    bool AtEnd() const {
+        return data_.empty();
+    }
+
+private:
+    std::string_view Take(size_t size);
+
+    std::string_view data_;
+};
+
+std::string EncodeFrame(const ShardFrame& frame);
+
+// вынимает из начала buffer первый полный кадр; false - кадр пришёл не целиком
+bool DecodeFrame(std::string& buffer, ShardFrame& frame);
+
+struct AddDocumentRequest {
+    int document_id = 0;
+    std::string document;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
+struct ShardSearchRequest {
+    std::string raw_query;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    TermStatistics statistics;
+};
+
+std::string EncodeAddDocument(const AddDocumentRequest& request);
+AddDocumentRequest DecodeAddDocument(std::string_view payload);
+
+std::string EncodeTermStatistics(const TermStatistics& statistics);
+TermStatistics DecodeTermStatistics(std::string_view payload);
+
+std::string EncodeSearchRequest(const ShardSearchRequest& request);
+ShardSearchRequest DecodeSearchRequest(std::string_view payload);
+
+std::string EncodeDocuments(const std::vector<Document>& documents);
+std::vector<Document> DecodeDocuments(std::string_view payload);
+
+// адрес вида "unix:/путь/к/сокету" или "tcp:127.0.0.1:порт";
+// при ошибке бросают std::system_error
+int ListenOnAddress(const std::string& address);
+int ConnectToAddress(const std::string& address);
+int AcceptConnection(int listen_fd);
+
+// пишет data целиком (блокирующий сокет)
+void SendAll(int fd, std::string_view data);
+
+// дописывает в buffer доступные байты; false - соединение закрыто
+bool ReceiveSome(int fd, std::string& buffer);
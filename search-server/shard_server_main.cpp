@@ -0,0 +1,103 @@
+#include "search_server.h"
+#include "shard_protocol.h"
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <execution>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+ShardFrame HandleRequest(SearchServer& search_server, const ShardFrame& request) {
+    ShardFrame reply;
+    reply.request_id = request.request_id;
+    try {
+        switch (request.type) {
+        case ShardMessageType::ADD_DOCUMENT: {
+            const AddDocumentRequest document = DecodeAddDocument(request.payload);
+            search_server.AddDocument(document.document_id, document.document, document.status, document.ratings);
+            reply.type = ShardMessageType::OK;
+            break;
+        }
+        case ShardMessageType::TERM_STATISTICS: {
+            PayloadReader reader(request.payload);
+            reply.type = ShardMessageType::TERM_STATISTICS_REPLY;
+            reply.payload = EncodeTermStatistics(search_server.GetTermStatistics(reader.ReadString()));
+            break;
+        }
+        case ShardMessageType::SEARCH: {
+            const ShardSearchRequest search = DecodeSearchRequest(request.payload);
+            reply.type = ShardMessageType::SEARCH_REPLY;
+            reply.payload = EncodeDocuments(search_server.FindTopDocuments(execution::seq, search.raw_query,
+                                                                           search.status, search.statistics));
+            break;
+        }
+        default:
+            throw ShardProtocolError("Unknown request type");
+        }
+    } catch (const exception& error) {
+        reply.type = ShardMessageType::ERROR;
+        reply.payload = error.what();
+    }
+    return reply;
+}
+
+} // namespace
+
+// search_shard_server <unix:/путь | tcp:127.0.0.1:порт> ["стоп-слова"]
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Usage: "s << argv[0] << " <unix:/path | tcp:host:port> [stop words]"s << endl;
+        return 1;
+    }
+
+    try {
+        SearchServer search_server(argc > 2 ? string(argv[2]) : string());
+        const int listen_fd = ListenOnAddress(argv[1]);
+
+        // принятые байты каждого клиента, ещё не сложившиеся в кадр
+        map<int, string> buffers;
+        vector<pollfd> poll_fds;
+        while (true) {
+            poll_fds.assign(1, {listen_fd, POLLIN, 0});
+            for (const auto& [fd, _] : buffers) {
+                poll_fds.push_back({fd, POLLIN, 0});
+            }
+            if (poll(poll_fds.data(), poll_fds.size(), -1) < 0) {
+                continue;
+            }
+
+            if (poll_fds[0].revents & POLLIN) {
+                buffers[AcceptConnection(listen_fd)];
+            }
+            for (size_t i = 1; i < poll_fds.size(); ++i) {
+                if (poll_fds[i].revents == 0) {
+                    continue;
+                }
+                const int fd = poll_fds[i].fd;
+                string& buffer = buffers.at(fd);
+                try {
+                    if (!ReceiveSome(fd, buffer)) {
+                        throw ShardProtocolError("Connection closed");
+                    }
+                    ShardFrame request;
+                    while (DecodeFrame(buffer, request)) {
+                        SendAll(fd, EncodeFrame(HandleRequest(search_server, request)));
+                    }
+                } catch (const exception&) {
+                    close(fd);
+                    buffers.erase(fd);
+                }
+            }
+        }
+    } catch (const exception& error) {
+        cerr << error.what() << endl;
+        return 1;
+    }
+}
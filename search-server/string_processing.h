@@ -7,11 +7,11 @@
 std::vector<std::string_view> SplitIntoWords(std::string_view str) ;
 
 template <typename StringContainer>
-std::set<std::string_view, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
-    std::set<std::string_view, std::less<>> non_empty_strings ;
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
+    std::set<std::string, std::less<>> non_empty_strings ;
     for (std::string_view str : strings) {
         if (!str.empty()) {
-            non_empty_strings.insert(str);
+            non_empty_strings.emplace(str);
         }
     }
     return non_empty_strings;
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+/**
+ * Число документов, их суммарная длина и документные частоты слов запроса.
+ * Статистики нескольких индексов (шардов) складываются, и IDF и средняя
+ * длина документа, посчитанные по сумме, совпадают с общим индексом.
+ */
+struct TermStatistics {
+    int document_count = 0;
+    int64_t word_count = 0;
+    std::map<std::string, int, std::less<>> document_freqs;
+
+    void Add(const TermStatistics& other) {
+        document_count += other.document_count;
+        word_count += other.word_count;
+        for (const auto& [word, document_freq] : other.document_freqs) {
+            document_freqs[word] += document_freq;
+        }
+    }
+};
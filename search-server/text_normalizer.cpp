@@ -0,0 +1,399 @@
+#include "text_normalizer.h"
+#include "string_processing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+
+namespace {
+
+const uint64_t ONES = 0x0101010101010101ULL;
+const uint64_t HIGH_BITS = 0x8080808080808080ULL;
+const uint64_t SPACES = 0x2020202020202020ULL;
+// длиннее слова нормализуются без кэша
+const size_t MAX_CACHED_WORD_SIZE = 48;
+
+std::atomic<uint64_t> next_normalizer_id{1};
+
+struct CachedWord {
+    std::string word;
+    std::string normalized;
+};
+
+// кэш с прямым отображением: слово занимает ячейку по своему хешу
+struct NormalizationCache {
+    uint64_t owner = 0;
+    std::vector<CachedWord> words;
+};
+
+thread_local NormalizationCache normalization_cache;
+
+struct CodePointRange {
+    char32_t first;
+    char32_t last;
+};
+
+// пробельные и управляющие символы вне ASCII
+const CodePointRange SPACE_RANGES[] = {
+    {0x0080, 0x00A0}, {0x1680, 0x1680}, {0x2000, 0x200B}, {0x2028, 0x2029},
+    {0x202F, 0x202F}, {0x205F, 0x205F}, {0x3000, 0x3000}, {0xFEFF, 0xFEFF},
+};
+
+// знаки препинания основных письменностей (и знаки Latin-1)
+const CodePointRange PUNCTUATION_RANGES[] = {
+    {0x00A1, 0x00A9}, {0x00AB, 0x00AC}, {0x00AE, 0x00B1}, {0x00B4, 0x00B4},
+    {0x00B6, 0x00B8}, {0x00BB, 0x00BB}, {0x00BF, 0x00BF}, {0x00D7, 0x00D7},
+    {0x00F7, 0x00F7}, {0x037E, 0x037E}, {0x0387, 0x0387}, {0x055A, 0x055F},
+    {0x0589, 0x058A}, {0x05BE, 0x05BE}, {0x05C0, 0x05C0}, {0x05C3, 0x05C3},
+    {0x05C6, 0x05C6}, {0x05F3, 0x05F4}, {0x060C, 0x060D}, {0x061B, 0x061B},
+    {0x061D, 0x061F}, {0x066A, 0x066D}, {0x06D4, 0x06D4}, {0x0964, 0x0965},
+    {0x0970, 0x0970}, {0x0E4F, 0x0E4F}, {0x0E5A, 0x0E5B}, {0x2010, 0x2027},
+    {0x2030, 0x205E}, {0x20A0, 0x20CF}, {0x2E00, 0x2E7F}, {0x3001, 0x3003},
+    {0x3008, 0x3011}, {0x3014, 0x301F}, {0x3030, 0x3030}, {0x303D, 0x303D},
+    {0x30FB, 0x30FB}, {0xFE10, 0xFE19}, {0xFE30, 0xFE6F}, {0xFF01, 0xFF0F},
+    {0xFF1A, 0xFF20}, {0xFF3B, 0xFF40}, {0xFF5B, 0xFF65},
+};
+
+template <size_t N>
+bool IsInRanges(const CodePointRange (&ranges)[N], char32_t code_point) {
+    const auto it = std::upper_bound(std::begin(ranges), std::end(ranges), code_point,
+                                     [](char32_t value, const CodePointRange& range) {
+                                         return value < range.first;
+                                     });
+    return it != std::begin(ranges) && code_point <= std::prev(it)->last;
+}
+
+bool IsAsciiSpace(unsigned char c) {
+    return c <= ' ' || c == 0x7F;
+}
+
+bool IsAsciiAlnum(unsigned char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+// старший бит каждого байта block (все байты < 0x80), лежащего в [first, last]
+uint64_t MatchRange(uint64_t block, unsigned char first, unsigned char last) {
+    const uint64_t at_least_first = block + (0x80 - first) * ONES;
+    const uint64_t above_last = block + (0x7F - last) * ONES;
+    return at_least_first & ~above_last & HIGH_BITS;
+}
+
+bool IsAscii(std::string_view text) {
+    uint64_t high_bits = 0;
+    size_t i = 0;
+    for (; i + 8 <= text.size(); i += 8) {
+        uint64_t block;
+        std::memcpy(&block, text.data() + i, 8);
+        high_bits |= block;
+    }
+    for (; i < text.size(); ++i) {
+        high_bits |= static_cast<unsigned char>(text[i]);
+    }
+    return (high_bits & HIGH_BITS) == 0;
+}
+
+// символы до U+07FF нормализуются по таблице быстрее, чем ищутся в кэше
+bool HasLongCodePoints(std::string_view word) {
+    return std::any_of(word.begin(), word.end(), [](char c) {
+        return static_cast<unsigned char>(c) >= 0xE0;
+    });
+}
+
+// длина символа UTF-8 с началом в text[0] и его номер; 0 - последовательность некорректна
+size_t DecodeUtf8(std::string_view text, char32_t& code_point) {
+    const auto lead = static_cast<unsigned char>(text[0]);
+    size_t length = 0;
+    char32_t min_code_point = 0;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+        code_point = lead & 0x1F;
+        min_code_point = 0x80;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        code_point = lead & 0x0F;
+        min_code_point = 0x800;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        code_point = lead & 0x07;
+        min_code_point = 0x10000;
+    } else {
+        return 0;
+    }
+    if (text.size() < length) {
+        return 0;
+    }
+    for (size_t i = 1; i < length; ++i) {
+        const auto byte = static_cast<unsigned char>(text[i]);
+        if ((byte & 0xC0) != 0x80) {
+            return 0;
+        }
+        code_point = (code_point << 6) | (byte & 0x3F);
+    }
+    if (code_point < min_code_point || code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+        return 0;
+    }
+    return length;
+}
+
+void EncodeUtf8(char32_t code_point, size_t length, char* result) {
+    for (size_t i = length - 1; i > 0; --i) {
+        result[i] = static_cast<char>(0x80 | (code_point & 0x3F));
+        code_point >>= 6;
+    }
+    static const unsigned char LEAD_BITS[] = {0, 0, 0xC0, 0xE0, 0xF0};
+    result[0] = static_cast<char>(LEAD_BITS[length] | code_point);
+}
+
+// строчная буква той же длины в UTF-8 или сам code_point
+char32_t FoldCase(char32_t code_point) {
+    const auto to_odd = [](char32_t c) { return c % 2 == 0 ? c + 1 : c; };
+    const auto to_even = [](char32_t c) { return c % 2 == 1 ? c + 1 : c; };
+
+    if (code_point < 0x0100) {
+        return code_point >= 0xC0 && code_point <= 0xDE && code_point != 0xD7 ? code_point + 0x20 : code_point;
+    }
+    if (code_point < 0x0180) {
+        // İ и ı меняют длину или не имеют пары
+        if (code_point == 0x0130 || code_point == 0x0131 || code_point == 0x0138
+            || code_point == 0x0149 || code_point == 0x017F) {
+            return code_point;
+        }
+        if (code_point == 0x0178) {
+            return 0x00FF;
+        }
+        if ((code_point >= 0x0139 && code_point <= 0x0148) || code_point >= 0x0179) {
+            return to_even(code_point);
+        }
+        return to_odd(code_point);
+    }
+    if (code_point >= 0x0386 && code_point <= 0x03AB) {
+        if (code_point == 0x0386) {
+            return 0x03AC;
+        }
+        if (code_point >= 0x0388 && code_point <= 0x038A) {
+            return code_point + 0x25;
+        }
+        if (code_point == 0x038C) {
+            return 0x03CC;
+        }
+        if (code_point == 0x038E || code_point == 0x038F) {
+            return code_point + 0x3F;
+        }
+        if (code_point >= 0x0391 && code_point != 0x03A2) {
+            return code_point + 0x20;
+        }
+        return code_point;
+    }
+    if (code_point >= 0x03D8 && code_point <= 0x03EF) {
+        return to_odd(code_point);
+    }
+    if (code_point >= 0x0400 && code_point <= 0x052F) {
+        if (code_point >= 0x0500) {
+            return to_odd(code_point);
+        }
+        if (code_point < 0x0410) {
+            return code_point + 0x50;
+        }
+        if (code_point < 0x0430) {
+            return code_point + 0x20;
+        }
+        if ((code_point >= 0x0460 && code_point <= 0x0481) || (code_point >= 0x048A && code_point <= 0x04BF)
+            || code_point >= 0x04D0) {
+            return to_odd(code_point);
+        }
+        if (code_point == 0x04C0) {
+            return 0x04CF;
+        }
+        if (code_point >= 0x04C1 && code_point <= 0x04CE) {
+            return to_even(code_point);
+        }
+        return code_point;
+    }
+    if (code_point >= 0x0531 && code_point <= 0x0556) {
+        return code_point + 0x30;
+    }
+    if (code_point >= 0x1E00 && code_point <= 0x1EFF && (code_point < 0x1E96 || code_point > 0x1E9F)) {
+        return to_odd(code_point);
+    }
+    if (code_point >= 0xFF21 && code_point <= 0xFF3A) {
+        return code_point + 0x20;
+    }
+    return code_point;
+}
+
+} // namespace
+
+TextNormalizer::TextNormalizer(const TextNormalizerOptions& options)
+    : options_(options)
+    , id_(next_normalizer_id++)
+    , cache_mask_(0) {
+    if (options_.cache_size > 0) {
+        size_t cache_size = 1;
+        while (cache_size < options_.cache_size) {
+            cache_size *= 2;
+        }
+        cache_mask_ = cache_size - 1;
+    }
+    for (int c = 0; c < 128; ++c) {
+        char normalized = static_cast<char>(c);
+        if (IsAsciiSpace(c) || (options_.split_on_punctuation && !IsAsciiAlnum(c))) {
+            normalized = ' ';
+        } else if (options_.fold_case && c >= 'A' && c <= 'Z') {
+            normalized = static_cast<char>(c - 'A' + 'a');
+        }
+        ascii_map_[c] = normalized;
+    }
+    two_byte_map_.resize(0x800);
+    for (char32_t code_point = 0x80; code_point < 0x800; ++code_point) {
+        if (IsSeparator(code_point)) {
+            two_byte_map_[code_point] = 0;
+        } else {
+            two_byte_map_[code_point] = static_cast<char16_t>(options_.fold_case ? FoldCase(code_point) : code_point);
+        }
+    }
+}
+
+bool TextNormalizer::IsSeparator(char32_t code_point) const {
+    return IsInRanges(SPACE_RANGES, code_point)
+        || (options_.split_on_punctuation && IsInRanges(PUNCTUATION_RANGES, code_point));
+}
+
+const TextNormalizerOptions& TextNormalizer::GetOptions() const {
+    return options_;
+}
+
+void TextNormalizer::Normalize(std::string_view text, std::string& result) const {
+    result.resize(text.size());
+    if (IsAscii(text)) {
+        NormalizeAscii(text.data(), text.size(), result.data());
+        return;
+    }
+
+    if (options_.cache_size > 0 && normalization_cache.owner != id_) {
+        normalization_cache.owner = id_;
+        normalization_cache.words.assign(cache_mask_ + 1, {});
+    }
+    // слова между пробелами ASCII нормализуются по отдельности
+    size_t pos = 0;
+    while (pos < text.size()) {
+        if (text[pos] == ' ') {
+            result[pos++] = ' ';
+            continue;
+        }
+        const size_t end = std::min(text.find(' ', pos), text.size());
+        const std::string_view word = text.substr(pos, end - pos);
+        if (IsAscii(word)) {
+            NormalizeAscii(word.data(), word.size(), result.data() + pos);
+        } else if (options_.cache_size > 0 && word.size() <= MAX_CACHED_WORD_SIZE && HasLongCodePoints(word)) {
+            NormalizeCachedWord(word, result.data() + pos);
+        } else {
+            NormalizeWord(word, result.data() + pos);
+        }
+        pos = end;
+    }
+}
+
+std::vector<std::string_view> TextNormalizer::Split(std::string_view text, std::string& storage) const {
+    Normalize(text, storage);
+    return SplitIntoWords(storage);
+}
+
+std::vector<std::string_view> TextNormalizer::SplitWhitespace(std::string_view text) const {
+    std::vector<std::string_view> words;
+    size_t word_begin = text.npos;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const auto c = static_cast<unsigned char>(text[pos]);
+        size_t length = 1;
+        bool is_space = false;
+        if (c < 0x80) {
+            is_space = IsAsciiSpace(c);
+        } else {
+            char32_t code_point = 0;
+            length = std::max<size_t>(DecodeUtf8(text.substr(pos), code_point), 1);
+            is_space = length > 1 && IsInRanges(SPACE_RANGES, code_point);
+        }
+        if (is_space && word_begin != text.npos) {
+            words.push_back(text.substr(word_begin, pos - word_begin));
+            word_begin = text.npos;
+        } else if (!is_space && word_begin == text.npos) {
+            word_begin = pos;
+        }
+        pos += length;
+    }
+    if (word_begin != text.npos) {
+        words.push_back(text.substr(word_begin));
+    }
+    return words;
+}
+
+void TextNormalizer::NormalizeAscii(const char* text, size_t size, char* result) const {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t block;
+        std::memcpy(&block, text + i, 8);
+        if (options_.fold_case) {
+            // 'A' | 0x20 == 'a': старший бит совпадения, сдвинутый на 2, даёт 0x20
+            block |= MatchRange(block, 'A', 'Z') >> 2;
+        }
+        uint64_t separators;
+        if (options_.split_on_punctuation) {
+            const uint64_t letters = MatchRange(block, 'a', 'z') | MatchRange(block, 'A', 'Z');
+            separators = ~(letters | MatchRange(block, '0', '9')) & HIGH_BITS;
+        } else {
+            separators = MatchRange(block, 0, ' ') | MatchRange(block, 0x7F, 0x7F);
+        }
+        // 0x80 в байте разделителя -> 0xFF
+        const uint64_t mask = (separators >> 7) * 0xFF;
+        block = (block & ~mask) | (SPACES & mask);
+        std::memcpy(result + i, &block, 8);
+    }
+    for (; i < size; ++i) {
+        result[i] = ascii_map_[static_cast<unsigned char>(text[i])];
+    }
+}
+
+void TextNormalizer::NormalizeWord(std::string_view word, char* result) const {
+    size_t pos = 0;
+    while (pos < word.size()) {
+        const auto c = static_cast<unsigned char>(word[pos]);
+        if (c < 0x80) {
+            result[pos++] = ascii_map_[c];
+            continue;
+        }
+        char32_t code_point = 0;
+        const size_t length = DecodeUtf8(word.substr(pos), code_point);
+        if (length == 0) {
+            result[pos] = word[pos];
+            ++pos;
+            continue;
+        }
+        if (length == 2) {
+            const char16_t normalized = two_byte_map_[code_point];
+            if (normalized == 0) {
+                result[pos] = result[pos + 1] = ' ';
+            } else {
+                EncodeUtf8(normalized, 2, result + pos);
+            }
+        } else if (IsSeparator(code_point)) {
+            std::fill_n(result + pos, length, ' ');
+        } else if (options_.fold_case) {
+            EncodeUtf8(FoldCase(code_point), length, result + pos);
+        } else {
+            std::copy_n(word.data() + pos, length, result + pos);
+        }
+        pos += length;
+    }
+}
+
+void TextNormalizer::NormalizeCachedWord(std::string_view word, char* result) const {
+    CachedWord& cached = normalization_cache.words[std::hash<std::string_view>{}(word) & cache_mask_];
+    if (cached.word == word) {
+        std::copy(cached.normalized.begin(), cached.normalized.end(), result);
+        return;
+    }
+    NormalizeWord(word, result);
+    cached.word.assign(word);
+    cached.normalized.assign(result, word.size());
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// настройки разбора текста на слова (см. SearchServer::EnableTextNormalization)
+struct TextNormalizerOptions {
+    // приводить буквы к нижнему регистру
+    bool fold_case = true;
+    // знаки препинания и символы ASCII, кроме букв и цифр, разделяют слова, как пробелы
+    bool split_on_punctuation = true;
+    // слов в кэше нормализации каждого потока (округляется до степени двойки); 0 - без кэша
+    size_t cache_size = 4096;
+};
+
+/**
+ * Нормализация UTF-8 текста перед разбиением на слова. Разделители - пробельные
+ * и управляющие символы Юникода и, если split_on_punctuation, знаки препинания -
+ * заменяются пробелами. Буквы латиницы, греческого, кириллицы, армянского алфавита
+ * и полноширинная латиница приводятся к нижнему регистру, если у обеих форм буквы
+ * одинаковая длина в UTF-8. Поэтому длина текста в байтах не меняется, и смещения
+ * в нормализованном тексте совпадают со смещениями в исходном.
+ * Некорректные последовательности UTF-8 копируются без изменений.
+ *
+ * Текст только из ASCII обрабатывается по 8 байт за шаг, символы до U+07FF -
+ * по таблице, а слова с более длинными символами (CJK, индийские письменности)
+ * берутся из кэша потока.
+ */
+class TextNormalizer {
+public:
+    explicit TextNormalizer(const TextNormalizerOptions& options = {});
+
+    const TextNormalizerOptions& GetOptions() const;
+
+    // записывает в result нормализованный text той же длины
+    void Normalize(std::string_view text, std::string& result) const;
+
+    // слова нормализованного text; указывают на storage
+    std::vector<std::string_view> Split(std::string_view text, std::string& storage) const;
+
+    // части text между пробельными и управляющими символами, без нормализации;
+    // так делится запрос, чтобы знаки -, + и * остались при своих словах
+    std::vector<std::string_view> SplitWhitespace(std::string_view text) const;
+
+private:
+    TextNormalizerOptions options_;
+    // кэш потока хранит слова одного нормализатора, id отличает их
+    uint64_t id_;
+    size_t cache_mask_;
+    // замена байтов ASCII вне быстрого пути
+    std::array<char, 128> ascii_map_;
+    // замена двухбайтовых символов (до U+07FF): строчная буква или 0 - разделитель
+    std::vector<char16_t> two_byte_map_;
+
+    bool IsSeparator(char32_t code_point) const;
+    void NormalizeAscii(const char* text, size_t size, char* result) const;
+    void NormalizeWord(std::string_view word, char* result) const;
+    void NormalizeCachedWord(std::string_view word, char* result) const;
+};
@@ -0,0 +1,305 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <set>
+
+void LatencyHistogram::Record(uint64_t value) {
+    buckets_[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t current_max = max_.load(std::memory_order_relaxed);
+    while (value > current_max
+           && !max_.compare_exchange_weak(current_max, value, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    return count_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetSum() const {
+    return sum_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetMax() const {
+    return max_.load(std::memory_order_relaxed);
+}
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return value;
+    }
+    const int highest_bit = 63 - __builtin_clzll(value);
+    const int shift = highest_bit - SUB_BUCKET_BITS;
+    const size_t group = shift + 1;
+    const size_t sub_bucket = (value >> shift) & (SUB_BUCKET_COUNT - 1);
+    return group * SUB_BUCKET_COUNT + sub_bucket;
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    const int shift = static_cast<int>(index / SUB_BUCKET_COUNT) - 1;
+    const uint64_t sub_bucket = index % SUB_BUCKET_COUNT;
+    const uint64_t lower_bound = (uint64_t{1} << (shift + SUB_BUCKET_BITS)) | (sub_bucket << shift);
+    return lower_bound + ((uint64_t{1} << shift) - 1);
+}
+
+HistogramSnapshot::HistogramSnapshot()
+    : buckets_(LatencyHistogram::BUCKET_COUNT, 0) {
+}
+
+void HistogramSnapshot::Add(const LatencyHistogram& histogram) {
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        buckets_[i] += histogram.buckets_[i].load(std::memory_order_relaxed);
+    }
+    count_ += histogram.GetCount();
+    sum_ += histogram.GetSum();
+    max_ = std::max(max_, histogram.GetMax());
+}
+
+void HistogramSnapshot::Add(const HistogramSnapshot& other) {
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+}
+
+void HistogramSnapshot::Record(uint64_t value, uint64_t count) {
+    buckets_[LatencyHistogram::GetBucketIndex(value)] += count;
+    count_ += count;
+    sum_ += value * count;
+    max_ = std::max(max_, value);
+}
+
+double HistogramSnapshot::GetMean() const {
+    return count_ == 0 ? 0.0 : static_cast<double>(sum_) / count_;
+}
+
+uint64_t HistogramSnapshot::GetPercentile(double percentile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    const double clamped = std::clamp(percentile, 0.0, 100.0);
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * count_)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            return std::min(LatencyHistogram::GetBucketUpperBound(i), max_);
+        }
+    }
+    return max_;
+}
+
+struct MergedTraceNode {
+    std::string name;
+    HistogramSnapshot histogram;
+    std::vector<MergedTraceNode> children;
+};
+
+namespace {
+
+void MergeNode(const TraceNode& source, MergedTraceNode& target) {
+    target.histogram.Add(source.histogram);
+    for (const auto& child : source.children) {
+        auto it = std::find_if(target.children.begin(), target.children.end(), [&child](const MergedTraceNode& node) {
+            return node.name == child->name;
+        });
+        if (it == target.children.end()) {
+            target.children.push_back({child->name, {}, {}});
+            it = std::prev(target.children.end());
+        }
+        MergeNode(*child, *it);
+    }
+}
+
+void WriteText(std::ostream& out, const MergedTraceNode& node, int depth) {
+    out << std::string(depth * 2, ' ') << node.name
+        << ": count=" << node.histogram.GetCount()
+        << " mean=" << static_cast<uint64_t>(node.histogram.GetMean()) << "ns"
+        << " p50=" << node.histogram.GetPercentile(50) << "ns"
+        << " p90=" << node.histogram.GetPercentile(90) << "ns"
+        << " p99=" << node.histogram.GetPercentile(99) << "ns"
+        << " max=" << node.histogram.GetMax() << "ns\n";
+    for (const MergedTraceNode& child : node.children) {
+        WriteText(out, child, depth + 1);
+    }
+}
+
+void WriteJsonString(std::ostream& out, std::string_view text) {
+    out << '"';
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+void WriteJsonChildren(std::ostream& out, const MergedTraceNode& node);
+
+void WriteJson(std::ostream& out, const MergedTraceNode& node) {
+    out << "{\"name\":";
+    WriteJsonString(out, node.name);
+    out << ",\"count\":" << node.histogram.GetCount()
+        << ",\"mean_ns\":" << static_cast<uint64_t>(node.histogram.GetMean())
+        << ",\"p50_ns\":" << node.histogram.GetPercentile(50)
+        << ",\"p90_ns\":" << node.histogram.GetPercentile(90)
+        << ",\"p99_ns\":" << node.histogram.GetPercentile(99)
+        << ",\"max_ns\":" << node.histogram.GetMax()
+        << ",\"children\":";
+    WriteJsonChildren(out, node);
+    out << '}';
+}
+
+void WriteJsonChildren(std::ostream& out, const MergedTraceNode& node) {
+    out << '[';
+    bool is_first = true;
+    for (const MergedTraceNode& child : node.children) {
+        if (!is_first) {
+            out << ',';
+        }
+        is_first = false;
+        WriteJson(out, child);
+    }
+    out << ']';
+}
+
+} // namespace
+
+TraceRegistry& TraceRegistry::Instance() {
+    static TraceRegistry registry;
+    return registry;
+}
+
+TraceRegistry::TraceRegistry()
+    : exited_threads_(std::make_unique<MergedTraceNode>()) {
+}
+
+TraceRegistry::~TraceRegistry() = default;
+
+TraceRegistry::ThreadTrace& TraceRegistry::GetThreadTrace() {
+    // после завершения потока его данные остаются только в реестре
+    // и при регистрации следующего потока или выводе сливаются в exited_threads_
+    thread_local std::shared_ptr<ThreadTrace> thread_trace;
+    if (!thread_trace) {
+        thread_trace = std::make_shared<ThreadTrace>();
+        std::lock_guard guard(mutex_);
+        MergeExitedThreads();
+        threads_.push_back(thread_trace);
+    }
+    return *thread_trace;
+}
+
+void TraceRegistry::MergeExitedThreads() {
+    const auto is_exited = [](const std::shared_ptr<ThreadTrace>& thread_trace) {
+        return thread_trace.use_count() == 1;
+    };
+    for (const auto& thread_trace : threads_) {
+        if (is_exited(thread_trace)) {
+            MergeNode(thread_trace->root, *exited_threads_);
+        }
+    }
+    threads_.erase(std::remove_if(threads_.begin(), threads_.end(), is_exited), threads_.end());
+}
+
+void TraceRegistry::Write(std::ostream& out, TraceFormat format) {
+    MergedTraceNode root;
+    {
+        std::lock_guard guard(mutex_);
+        MergeExitedThreads();
+        root = *exited_threads_;
+        for (const auto& thread_trace : threads_) {
+            std::lock_guard structure_guard(thread_trace->structure_mutex);
+            MergeNode(thread_trace->root, root);
+        }
+    }
+
+    if (format == TraceFormat::JSON) {
+        out << "{\"scopes\":";
+        WriteJsonChildren(out, root);
+        out << "}\n";
+    } else {
+        for (const MergedTraceNode& child : root.children) {
+            WriteText(out, child, 0);
+        }
+    }
+    out.flush();
+}
+
+const char* InternTraceName(std::string_view name) {
+    static std::mutex mutex;
+    static std::set<std::string, std::less<>> names;
+
+    std::lock_guard guard(mutex);
+    auto it = names.find(name);
+    if (it == names.end()) {
+        it = names.emplace(name).first;
+    }
+    return it->c_str();
+}
+
+#if SEARCH_SERVER_TRACING
+
+ScopedTrace::ScopedTrace(const char* name)
+    : thread_trace_(&TraceRegistry::Instance().GetThreadTrace())
+    , node_(nullptr) {
+    TraceNode* parent = thread_trace_->current;
+    for (const auto& child : parent->children) {
+        if (child->name == name || std::strcmp(child->name, name) == 0) {
+            node_ = child.get();
+            break;
+        }
+    }
+    if (node_ == nullptr) {
+        std::lock_guard guard(thread_trace_->structure_mutex);
+        parent->children.push_back(std::make_unique<TraceNode>(name, parent));
+        node_ = parent->children.back().get();
+    }
+    thread_trace_->current = node_;
+    start_time_ = Clock::now();
+}
+
+ScopedTrace::~ScopedTrace() {
+    node_->histogram.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_time_).count());
+    thread_trace_->current = node_->parent;
+}
+
+#else
+
+ScopedTrace::ScopedTrace(const char*) {
+}
+
+ScopedTrace::~ScopedTrace() {
+}
+
+#endif
+
+TraceDumper::TraceDumper(std::ostream& out, std::chrono::milliseconds period, TraceFormat format)
+    : out_(out)
+    , period_(period)
+    , format_(format) {
+    thread_ = std::thread([this] {
+        std::unique_lock lock(mutex_);
+        while (!stop_condition_.wait_for(lock, period_, [this] { return stop_; })) {
+            TraceRegistry::Instance().Write(out_, format_);
+        }
+    });
+}
+
+TraceDumper::~TraceDumper() {
+    {
+        std::lock_guard guard(mutex_);
+        stop_ = true;
+    }
+    stop_condition_.notify_one();
+    thread_.join();
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// 0 - трассировка вырезается при компиляции, TRACE_SCOPE ничего не стоит
+#ifndef SEARCH_SERVER_TRACING
+#define SEARCH_SERVER_TRACING 1
+#endif
+
+#define TRACE_CONCAT_INTERNAL(X, Y) X##Y
+#define TRACE_CONCAT(X, Y) TRACE_CONCAT_INTERNAL(X, Y)
+
+/**
+ * Замеряет время до конца текущего блока и записывает его в гистограмму
+ * узла с именем name. Вложенные TRACE_SCOPE образуют иерархию:
+ *
+ *  void Query() {
+ *      TRACE_SCOPE("query");
+ *      {
+ *          TRACE_SCOPE("parse"); // узел query/parse
+ *          ...
+ *      }
+ *  }
+ *
+ * name должно жить до конца программы (обычно это строковый литерал).
+ */
+#if SEARCH_SERVER_TRACING
+#define TRACE_SCOPE(name) ScopedTrace TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) static_cast<void>(0)
+#endif
+
+/**
+ * Гистограмма задержек в наносекундах в стиле HDR:
+ * значения группируются по степеням двойки, каждая степень делится
+ * на SUB_BUCKET_COUNT равных частей (относительная погрешность ~6%).
+ * Запись - только relaxed-атомарные операции, без блокировок.
+ */
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static const int BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    void Record(uint64_t value);
+
+    uint64_t GetCount() const;
+    uint64_t GetSum() const;
+    uint64_t GetMax() const;
+
+    static size_t GetBucketIndex(uint64_t value);
+    // наибольшее значение, попадающее в корзину index
+    static uint64_t GetBucketUpperBound(size_t index);
+
+private:
+    friend class HistogramSnapshot;
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// неатомарная копия гистограммы для слияния и вывода
+class HistogramSnapshot {
+public:
+    HistogramSnapshot();
+
+    void Add(const LatencyHistogram& histogram);
+    void Add(const HistogramSnapshot& other);
+    void Record(uint64_t value, uint64_t count = 1);
+
+    uint64_t GetCount() const {
+        return count_;
+    }
+
+    uint64_t GetMax() const {
+        return max_;
+    }
+
+    double GetMean() const;
+
+    // percentile в диапазоне [0, 100]
+    uint64_t GetPercentile(double percentile) const;
+
+private:
+    std::vector<uint64_t> buckets_;
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
+struct TraceNode {
+    explicit TraceNode(const char* node_name, TraceNode* parent_node = nullptr)
+        : name(node_name)
+        , parent(parent_node) {
+    }
+
+    const char* name;
+    TraceNode* parent;
+    // дочерние узлы добавляет только поток-владелец, под мьютексом потока
+    std::vector<std::unique_ptr<TraceNode>> children;
+    LatencyHistogram histogram;
+};
+
+// узел, слитый из узлов с одинаковым путём в нескольких потоках
+struct MergedTraceNode;
+
+enum class TraceFormat {
+    TEXT,
+    JSON,
+};
+
+// узлы трассировки всех потоков
+class TraceRegistry {
+public:
+    static TraceRegistry& Instance();
+
+    // дерево узлов текущего потока
+    struct ThreadTrace {
+        std::mutex structure_mutex;
+        TraceNode root{""};
+        TraceNode* current = &root;
+    };
+
+    ThreadTrace& GetThreadTrace();
+
+    // сливает узлы с одинаковым путём из всех потоков
+    void Write(std::ostream& out, TraceFormat format);
+
+private:
+    TraceRegistry();
+    ~TraceRegistry();
+
+    // переносит деревья завершившихся потоков в exited_threads_; под mutex_
+    void MergeExitedThreads();
+
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<ThreadTrace>> threads_;
+    // замеры завершившихся потоков
+    std::unique_ptr<MergedTraceNode> exited_threads_;
+};
+
+// возвращает постоянный указатель на копию name (для имён, известных только во время работы)
+const char* InternTraceName(std::string_view name);
+
+class ScopedTrace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ScopedTrace(const char* name);
+    ~ScopedTrace();
+
+    ScopedTrace(const ScopedTrace&) = delete;
+    ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+    std::chrono::nanoseconds GetElapsed() const {
+        return Clock::now() - start_time_;
+    }
+
+private:
+#if SEARCH_SERVER_TRACING
+    TraceRegistry::ThreadTrace* thread_trace_;
+    TraceNode* node_;
+#endif
+    Clock::time_point start_time_ = Clock::now();
+};
+
+// периодически выводит накопленную трассировку в поток
+class TraceDumper {
+public:
+    TraceDumper(std::ostream& out, std::chrono::milliseconds period, TraceFormat format = TraceFormat::TEXT);
+    ~TraceDumper();
+
+private:
+    std::ostream& out_;
+    const std::chrono::milliseconds period_;
+    const TraceFormat format_;
+    std::mutex mutex_;
+    std::condition_variable stop_condition_;
+    bool stop_ = false;
+    std::thread thread_;
+};
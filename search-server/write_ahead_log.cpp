@@ -0,0 +1,349 @@
+#include "write_ahead_log.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <system_error>
+
+namespace {
+
+// длина данных, CRC, номер записи, тип
+const size_t RECORD_HEADER_SIZE = 4 + 4 + 8 + 1;
+// больше не пишем; большее значение длины - мусор на месте оборванной записи
+const uint32_t MAX_RECORD_SIZE = 256 * 1024 * 1024;
+// WriteWalFile пишет кусками такого размера
+const size_t WRITE_CHUNK_SIZE = 1 << 20;
+
+std::array<uint32_t, 256> MakeCrc32Table() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t value = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            value = (value & 1) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
+        }
+        table[i] = value;
+    }
+    return table;
+}
+
+void AppendUint(std::string& out, uint64_t value, int size) {
+    for (int i = 0; i < size; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+uint64_t ParseUint(const char* data, int size) {
+    uint64_t value = 0;
+    for (int i = size - 1; i >= 0; --i) {
+        value = (value << 8) | static_cast<unsigned char>(data[i]);
+    }
+    return value;
+}
+
+void AppendRecord(std::string& out, uint64_t lsn, WalRecordType type, std::string_view payload) {
+    const size_t start = out.size();
+    AppendUint(out, payload.size(), 4);
+    AppendUint(out, 0, 4);
+    AppendUint(out, lsn, 8);
+    out.push_back(static_cast<char>(type));
+    out.append(payload);
+
+    const std::string_view body = std::string_view(out).substr(start + 8);
+    const uint32_t crc = ComputeCrc32(body);
+    for (int i = 0; i < 4; ++i) {
+        out[start + 4 + i] = static_cast<char>((crc >> (8 * i)) & 0xFF);
+    }
+}
+
+[[noreturn]] void ThrowSystemError(int error, const std::string& what) {
+    throw std::system_error(error, std::generic_category(), what);
+}
+
+// 0 или errno
+int WriteAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+    return 0;
+}
+
+// после создания или переименования файла запись каталога тоже нужно синхронизировать
+void SyncParentDirectory(const std::string& path) {
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    if (directory.empty()) {
+        directory = ".";
+    }
+    const int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        ThrowSystemError(errno, "open " + directory.string());
+    }
+    const int result = fsync(fd);
+    const int error = errno;
+    close(fd);
+    if (result != 0) {
+        ThrowSystemError(error, "fsync " + directory.string());
+    }
+}
+
+} // namespace
+
+uint32_t ComputeCrc32(std::string_view data, uint32_t crc) {
+    static const std::array<uint32_t, 256> table = MakeCrc32Table();
+    crc = ~crc;
+    for (const char c : data) {
+        crc = table[(crc ^ static_cast<unsigned char>(c)) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+WalReadResult ReadWriteAheadLog(const std::string& path) {
+    WalReadResult result;
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        return result;
+    }
+    const std::string data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    // длина записи известна только из заголовка, поэтому границы - последовательно
+    std::vector<size_t> offsets;
+    size_t position = 0;
+    while (data.size() - position >= RECORD_HEADER_SIZE) {
+        const uint64_t size = ParseUint(data.data() + position, 4);
+        if (size > MAX_RECORD_SIZE || data.size() - position - RECORD_HEADER_SIZE < size) {
+            break;
+        }
+        offsets.push_back(position);
+        position += RECORD_HEADER_SIZE + size;
+    }
+
+    result.records.resize(offsets.size());
+    std::vector<char> is_valid(offsets.size());
+    std::vector<size_t> indexes(offsets.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](size_t i) {
+        const char* header = data.data() + offsets[i];
+        const size_t size = ParseUint(header, 4);
+        const std::string_view body(header + 8, RECORD_HEADER_SIZE - 8 + size);
+        if (ComputeCrc32(body) != ParseUint(header + 4, 4)) {
+            return;
+        }
+        WalRecord& record = result.records[i];
+        record.lsn = ParseUint(header + 8, 8);
+        record.type = static_cast<WalRecordType>(header[16]);
+        record.payload.assign(header + RECORD_HEADER_SIZE, size);
+        is_valid[i] = 1;
+    });
+
+    // всё после первой испорченной записи не считается записанным
+    const size_t valid_count = std::find(is_valid.begin(), is_valid.end(), 0) - is_valid.begin();
+    result.records.resize(valid_count);
+    result.valid_bytes = valid_count < offsets.size() ? offsets[valid_count] : position;
+    return result;
+}
+
+void WriteWalFile(const std::string& path, const std::vector<WalRecord>& records) {
+    const std::string temporary_path = path + ".tmp";
+    const int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        ThrowSystemError(errno, "open " + temporary_path);
+    }
+
+    int error = 0;
+    std::string chunk;
+    for (size_t i = 0; i < records.size() && error == 0; ++i) {
+        AppendRecord(chunk, records[i].lsn, records[i].type, records[i].payload);
+        if (chunk.size() >= WRITE_CHUNK_SIZE || i + 1 == records.size()) {
+            error = WriteAll(fd, chunk);
+            chunk.clear();
+        }
+    }
+    if (error == 0 && fsync(fd) != 0) {
+        error = errno;
+    }
+    close(fd);
+    if (error != 0) {
+        ThrowSystemError(error, "write " + temporary_path);
+    }
+    if (rename(temporary_path.c_str(), path.c_str()) != 0) {
+        ThrowSystemError(errno, "rename " + temporary_path);
+    }
+    SyncParentDirectory(path);
+}
+
+WriteAheadLog::WriteAheadLog(std::string path, uint64_t valid_bytes, uint64_t next_lsn, const WriteAheadLogOptions& options)
+    : path_(std::move(path))
+    , options_(options)
+    , next_lsn_(next_lsn)
+    , durable_lsn_(next_lsn - 1) {
+    OpenFile(valid_bytes);
+    flusher_ = std::thread([this] {
+        FlushLoop();
+    });
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    flush_requested_.notify_one();
+    flusher_.join();
+    close(fd_);
+}
+
+void WriteAheadLog::OpenFile(uint64_t valid_bytes) {
+    fd_ = open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        ThrowSystemError(errno, "open " + path_);
+    }
+    struct stat file_stat{};
+    if (fstat(fd_, &file_stat) != 0) {
+        const int error = errno;
+        close(fd_);
+        ThrowSystemError(error, "fstat " + path_);
+    }
+    // хвост, оборванный при сбое, иначе новые записи оказались бы за ним недоступны
+    if (static_cast<uint64_t>(file_stat.st_size) > valid_bytes) {
+        if (ftruncate(fd_, static_cast<off_t>(valid_bytes)) != 0 || fsync(fd_) != 0) {
+            const int error = errno;
+            close(fd_);
+            ThrowSystemError(error, "truncate " + path_);
+        }
+    }
+    SyncParentDirectory(path_);
+}
+
+uint64_t WriteAheadLog::Append(WalRecordType type, std::string_view payload) {
+    std::unique_lock lock(mutex_);
+    if (error_ != 0) {
+        ThrowSystemError(error_, "write " + path_);
+    }
+    const bool was_empty = buffer_.empty();
+    if (was_empty) {
+        buffer_started_ = std::chrono::steady_clock::now();
+    }
+    const uint64_t lsn = next_lsn_++;
+    AppendRecord(buffer_, lsn, type, payload);
+    const bool is_full = buffer_.size() >= options_.commit_bytes;
+    lock.unlock();
+
+    // поток сброса ждёт первой записи, чтобы засечь commit_interval
+    if (was_empty || is_full) {
+        flush_requested_.notify_one();
+    }
+    return lsn;
+}
+
+void WriteAheadLog::WaitDurable(uint64_t lsn) {
+    std::unique_lock lock(mutex_);
+    WaitDurableLocked(lock, lsn);
+}
+
+void WriteAheadLog::WaitDurableLocked(std::unique_lock<std::mutex>& lock, uint64_t lsn) {
+    ++waiters_;
+    flush_requested_.notify_one();
+    durable_changed_.wait(lock, [this, lsn] {
+        return durable_lsn_ >= lsn || error_ != 0;
+    });
+    --waiters_;
+    if (error_ != 0) {
+        ThrowSystemError(error_, "write " + path_);
+    }
+}
+
+void WriteAheadLog::Sync() {
+    std::unique_lock lock(mutex_);
+    WaitDurableLocked(lock, next_lsn_ - 1);
+}
+
+void WriteAheadLog::Rotate(const std::string& rotated_path) {
+    std::unique_lock lock(mutex_);
+    while (durable_lsn_ < next_lsn_ - 1) {
+        WaitDurableLocked(lock, next_lsn_ - 1);
+    }
+    // всё записано и сброс не идёт, а Append ждёт mutex_, поэтому файл можно подменить
+    close(fd_);
+    fd_ = -1;
+    if (rename(path_.c_str(), rotated_path.c_str()) != 0) {
+        error_ = errno;
+        ThrowSystemError(error_, "rename " + path_);
+    }
+    try {
+        OpenFile(0);
+    } catch (const std::system_error& error) {
+        error_ = error.code().value();
+        throw;
+    }
+}
+
+uint64_t WriteAheadLog::GetLastLsn() const {
+    std::lock_guard lock(mutex_);
+    return next_lsn_ - 1;
+}
+
+uint64_t WriteAheadLog::GetDurableLsn() const {
+    std::lock_guard lock(mutex_);
+    return durable_lsn_;
+}
+
+uint64_t WriteAheadLog::GetSyncCount() const {
+    std::lock_guard lock(mutex_);
+    return sync_count_;
+}
+
+void WriteAheadLog::FlushLoop() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+        if (buffer_.empty()) {
+            if (stop_) {
+                return;
+            }
+            flush_requested_.wait(lock);
+            continue;
+        }
+        if (!stop_ && waiters_ == 0 && buffer_.size() < options_.commit_bytes) {
+            const auto commit_time = buffer_started_ + options_.commit_interval;
+            if (std::chrono::steady_clock::now() < commit_time) {
+                flush_requested_.wait_until(lock, commit_time);
+                continue;
+            }
+        }
+
+        // пока идёт запись, новые записи копятся в buffer_ для следующей группы
+        std::string group;
+        group.swap(buffer_);
+        const uint64_t group_lsn = next_lsn_ - 1;
+        lock.unlock();
+
+        int error = WriteAll(fd_, group);
+        if (error == 0 && fdatasync(fd_) != 0) {
+            error = errno;
+        }
+
+        lock.lock();
+        if (error != 0) {
+            error_ = error;
+            buffer_.clear();
+        } else {
+            durable_lsn_ = group_lsn;
+            ++sync_count_;
+        }
+        durable_changed_.notify_all();
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * Журнал упреждающей записи: файл из записей
+ * длина данных (4 байта) | CRC32 (4 байта) | номер записи (8 байт) | тип (1 байт) | данные.
+ * CRC считается по номеру, типу и данным. Числа - little-endian.
+ *
+ * Append только кладёт запись в буфер; фоновый поток пишет накопленные
+ * записи одним write и одним fdatasync (групповая фиксация). Сброс
+ * начинается сразу, если кто-то ждёт в WaitDurable, иначе - через
+ * commit_interval или при накоплении commit_bytes байт.
+ *
+ * Ошибка ввода-вывода необратима: записи неудачной группы могли частично
+ * попасть на диск, поэтому все последующие Append, WaitDurable, Sync и Rotate
+ * бросают std::system_error. Продолжить можно, только открыв журнал заново.
+ */
+enum class WalRecordType : uint8_t {
+    ADD_DOCUMENT = 1,
+    REMOVE_DOCUMENT = 2,
+    // первая запись снимка: номер последней записи журнала, вошедшей в снимок
+    CHECKPOINT = 3,
+};
+
+struct WalRecord {
+    uint64_t lsn = 0;
+    WalRecordType type = WalRecordType::ADD_DOCUMENT;
+    std::string payload;
+};
+
+struct WriteAheadLogOptions {
+    std::chrono::microseconds commit_interval{2000};
+    size_t commit_bytes = 1 << 20;
+};
+
+struct WalReadResult {
+    std::vector<WalRecord> records;
+    // длина неповреждённого начала файла; дальше - оборванная при сбое запись
+    uint64_t valid_bytes = 0;
+};
+
+// читает журнал или снимок; отсутствующий файл - пустой журнал.
+// Границы записей ищутся последовательно, CRC и разбор - параллельно
+WalReadResult ReadWriteAheadLog(const std::string& path);
+
+// записывает records в path через временный файл и rename, с fsync файла и каталога
+void WriteWalFile(const std::string& path, const std::vector<WalRecord>& records);
+
+uint32_t ComputeCrc32(std::string_view data, uint32_t crc = 0);
+
+class WriteAheadLog {
+public:
+    // открывает path на дозапись, отрезая повреждённый хвост длиной больше valid_bytes;
+    // номера новых записей начинаются с next_lsn
+    WriteAheadLog(std::string path, uint64_t valid_bytes, uint64_t next_lsn, const WriteAheadLogOptions& options = {});
+
+    // сбрасывает и синхронизирует все записи
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // возвращает номер записи
+    uint64_t Append(WalRecordType type, std::string_view payload);
+
+    // ждёт, пока запись lsn окажется на диске; при ошибке ввода-вывода бросает std::system_error
+    void WaitDurable(uint64_t lsn);
+
+    void Sync();
+
+    // синхронизирует журнал, переименовывает его в rotated_path и начинает пустой файл
+    void Rotate(const std::string& rotated_path);
+
+    uint64_t GetLastLsn() const;
+    uint64_t GetDurableLsn() const;
+    // число выполненных fdatasync
+    uint64_t GetSyncCount() const;
+
+private:
+    void OpenFile(uint64_t valid_bytes);
+    void FlushLoop();
+    // ждёт, пока на диске окажутся записи до lsn включительно; вызывается под mutex_
+    void WaitDurableLocked(std::unique_lock<std::mutex>& lock, uint64_t lsn);
+
+    const std::string path_;
+    const WriteAheadLogOptions options_;
+    int fd_ = -1;
+
+    mutable std::mutex mutex_;
+    std::condition_variable flush_requested_;
+    std::condition_variable durable_changed_;
+    std::string buffer_;
+    uint64_t next_lsn_;
+    uint64_t durable_lsn_;
+    // время первой записи буфера, ещё не отданной на диск
+    std::chrono::steady_clock::time_point buffer_started_;
+    size_t waiters_ = 0;
+    bool stop_ = false;
+    int error_ = 0;
+    uint64_t sync_count_ = 0;
+    std::thread flusher_;
+};
@@ -0,0 +1,147 @@
+#include "process_queries.h"
+#include "search_server.h"
+#include "test_utils.h"
+
+#include <execution>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const string STOP_WORDS = "and in with";
+const int DOCUMENT_COUNT = 1500;
+const int QUERY_COUNT = 800;
+
+vector<string> MakeVocabulary() {
+    vector<string> vocabulary;
+    for (int i = 0; i < 400; ++i) {
+        vocabulary.push_back("w" + to_string(i));
+    }
+    vocabulary.push_back("and");
+    vocabulary.push_back("in");
+    return vocabulary;
+}
+
+// частые слова в начале словаря
+const string& PickWord(mt19937& generator, const vector<string>& vocabulary) {
+    const double x = uniform_real_distribution<double>(0.0, 1.0)(generator);
+    return vocabulary[static_cast<size_t>(x * x * x * vocabulary.size())];
+}
+
+// плотные id 0..N-1 или разреженные, далеко друг от друга
+SearchServer MakeServer(bool sparse_ids, const vector<string>& vocabulary) {
+    SearchServer search_server(STOP_WORDS);
+    mt19937 generator(sparse_ids ? 5 : 7);
+    for (int i = 0; i < DOCUMENT_COUNT; ++i) {
+        const int id = sparse_ids ? i * 7919 + 13 : i;
+        string text;
+        const size_t word_count = 2 + generator() % 30;
+        for (size_t j = 0; j < word_count; ++j) {
+            text += (j > 0 ? " " : "") + PickWord(generator, vocabulary);
+        }
+        const auto status = i % 11 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        search_server.AddDocument(id, text, status, {static_cast<int>(generator() % 21) - 10});
+    }
+    return search_server;
+}
+
+// обычные и минус-слова, стоп-слова, повторы, слова вне словаря; префиксы и +слова
+// уходят в поиск по одному запросу, но тоже должны совпадать
+vector<string> MakeQueries(const vector<string>& vocabulary) {
+    mt19937 generator(11);
+    vector<string> queries;
+    for (int i = 0; i < QUERY_COUNT; ++i) {
+        string query;
+        const size_t word_count = 1 + generator() % 6;
+        for (size_t j = 0; j < word_count; ++j) {
+            query += (j > 0 ? " " : "") + PickWord(generator, vocabulary);
+        }
+        if (i % 3 == 0) {
+            query += " -" + PickWord(generator, vocabulary);
+        }
+        if (i % 17 == 0) {
+            query += " unknown" + to_string(i);
+        }
+        if (i % 29 == 0) {
+            query += " w1*";
+        }
+        if (i % 31 == 0) {
+            query += " +" + vocabulary[generator() % 10];
+        }
+        queries.push_back(query);
+    }
+    queries.push_back("");
+    queries.push_back("and in");
+    return queries;
+}
+
+void CheckSameResults(const vector<Document>& expected, const vector<Document>& actual) {
+    CHECK(expected.size() == actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        CHECK(expected[i].id == actual[i].id);
+        CHECK(expected[i].rating == actual[i].rating);
+        CHECK(expected[i].relevance == actual[i].relevance);
+    }
+}
+
+template <typename ExecutionPolicy>
+void CheckBatch(const ExecutionPolicy& policy, const SearchServer& search_server, const vector<string>& queries,
+                DocumentStatus status) {
+    const vector<vector<Document>> results = search_server.FindTopDocumentsBatch(policy, queries, status);
+    CHECK(results.size() == queries.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        CheckSameResults(search_server.FindTopDocuments(queries[i], status), results[i]);
+    }
+}
+
+void TestBatchMatchesSingleQueries(bool sparse_ids) {
+    const vector<string> vocabulary = MakeVocabulary();
+    const SearchServer search_server = MakeServer(sparse_ids, vocabulary);
+    const vector<string> queries = MakeQueries(vocabulary);
+
+    for (const auto status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+        CheckBatch(execution::seq, search_server, queries, status);
+        CheckBatch(execution::par, search_server, queries, status);
+    }
+    const vector<vector<Document>> processed = ProcessQueries(search_server, queries);
+    CHECK(processed.size() == queries.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        CheckSameResults(search_server.FindTopDocuments(queries[i]), processed[i]);
+    }
+
+    // пачки короче группы и из одного запроса
+    const vector<string> short_batch(queries.begin(), queries.begin() + 5);
+    CheckBatch(execution::par, search_server, short_batch, DocumentStatus::ACTUAL);
+    CheckBatch(execution::seq, search_server, {queries[1]}, DocumentStatus::ACTUAL);
+    CHECK(search_server.FindTopDocumentsBatch(execution::par, {}).empty());
+
+    // некорректный запрос в пачке - исключение, как у FindTopDocuments
+    vector<string> invalid_batch = short_batch;
+    invalid_batch.push_back("w1 --w2");
+    bool is_rejected = false;
+    try {
+        search_server.FindTopDocumentsBatch(execution::par, invalid_batch);
+    } catch (const invalid_argument&) {
+        is_rejected = true;
+    }
+    CHECK(is_rejected);
+}
+
+} // namespace
+
+int main() {
+    try {
+        TestBatchMatchesSingleQueries(false);
+        TestBatchMatchesSingleQueries(true);
+    } catch (const exception& error) {
+        cerr << error.what() << endl;
+        return 1;
+    }
+    cout << "batch_search_test: OK" << endl;
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include "durable_search_server.h"
+#include "search_server.h"
+#include "test_utils.h"
+#include "write_ahead_log.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const string STOP_WORDS = "and in with";
+const int DOCUMENT_COUNT = 300;
+
+struct Change {
+    bool is_add = true;
+    int document_id = 0;
+    string text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    vector<int> ratings;
+};
+
+// добавления всех документов, удаление каждого пятого и повторные добавления удалённых
+vector<Change> MakeChanges() {
+    mt19937 generator(29);
+    const vector<string> vocabulary = {"cat", "dog", "bird", "fish", "white", "black", "big", "small",
+                                       "tail", "eyes", "and", "in", "with", "city", "river", "house"};
+    const auto make_text = [&] {
+        string text;
+        const size_t word_count = 3 + generator() % 10;
+        for (size_t i = 0; i < word_count; ++i) {
+            text += (i > 0 ? " " : "") + vocabulary[generator() % vocabulary.size()];
+        }
+        return text;
+    };
+
+    vector<Change> changes;
+    for (int id = 0; id < DOCUMENT_COUNT; ++id) {
+        const auto status = id % 9 == 0 ? DocumentStatus::IRRELEVANT : DocumentStatus::ACTUAL;
+        changes.push_back({true, id, make_text(), status, {static_cast<int>(generator() % 10), id % 4}});
+        if (id % 5 == 4) {
+            changes.push_back({false, id - 2, {}, {}, {}});
+        }
+    }
+    for (int id = 2; id < DOCUMENT_COUNT; id += 25) {
+        changes.push_back({true, id, make_text(), DocumentStatus::BANNED, {1}});
+    }
+    return changes;
+}
+
+template <typename Server>
+void Apply(Server& server, const Change& change) {
+    if (change.is_add) {
+        server.AddDocument(change.document_id, change.text, change.status, change.ratings);
+    } else {
+        server.RemoveDocument(change.document_id);
+    }
+}
+
+SearchServer MakeExpected(const vector<Change>& changes, size_t count) {
+    SearchServer search_server(STOP_WORDS);
+    for (size_t i = 0; i < count; ++i) {
+        Apply(search_server, changes[i]);
+    }
+    return search_server;
+}
+
+void CheckSameIndex(const SearchServer& expected, const SearchServer& actual) {
+    CHECK(expected.GetDocumentCount() == actual.GetDocumentCount());
+    for (const string query : {"cat", "dog -black", "white big tail", "river house city", "fish -small"}) {
+        for (const auto status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED, DocumentStatus::IRRELEVANT}) {
+            const auto expected_documents = expected.FindTopDocuments(query, status);
+            const auto actual_documents = actual.FindTopDocuments(query, status);
+            CHECK(expected_documents.size() == actual_documents.size());
+            for (size_t i = 0; i < expected_documents.size(); ++i) {
+                CHECK(expected_documents[i].id == actual_documents[i].id);
+                CHECK(expected_documents[i].rating == actual_documents[i].rating);
+            }
+        }
+    }
+}
+
+// дочерний процесс применяет изменения с Checkpoint посередине и завершается через _exit
+// без деструкторов, как при сбое: всё подтверждённое должно восстановиться
+void TestCrashRecovery(const filesystem::path& directory, const vector<Change>& changes) {
+    const pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0) {
+        try {
+            DurableSearchServer server(directory.string(), STOP_WORDS);
+            for (size_t i = 0; i < changes.size(); ++i) {
+                Apply(server, changes[i]);
+                if (i == changes.size() / 2) {
+                    server.Checkpoint();
+                }
+            }
+        } catch (...) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    int status = 0;
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    const DurableSearchServer server(directory.string(), STOP_WORDS);
+    CheckSameIndex(MakeExpected(changes, changes.size()), server.GetSearchServer());
+}
+
+// запись, оборванная на середине, отрезается, а журнал продолжается после последней целой записи
+void TestTruncatedTail(const filesystem::path& directory, const vector<Change>& changes) {
+    const string log_path = (directory / "wal").string();
+    const WalReadResult log = ReadWriteAheadLog(log_path);
+    CHECK(!log.records.empty());
+    CHECK(log.valid_bytes == filesystem::file_size(log_path));
+    filesystem::resize_file(log_path, log.valid_bytes - 3);
+
+    const SearchServer expected = MakeExpected(changes, changes.size() - 1);
+    {
+        DurableSearchServer server(directory.string(), STOP_WORDS);
+        CheckSameIndex(expected, server.GetSearchServer());
+        CHECK(filesystem::file_size(log_path) < log.valid_bytes);
+        server.AddDocument(DOCUMENT_COUNT, "cat with white tail", DocumentStatus::ACTUAL, {5});
+    }
+
+    const DurableSearchServer server(directory.string(), STOP_WORDS);
+    CHECK(server.GetSearchServer().GetDocumentCount() == expected.GetDocumentCount() + 1);
+    const auto documents = server.GetSearchServer().FindTopDocuments("tail", [](int document_id, DocumentStatus, int) {
+        return document_id == DOCUMENT_COUNT;
+    });
+    CHECK(documents.size() == 1);
+}
+
+// после ошибки записи журнал отказывает во всех следующих записях
+void TestStickyFailure() {
+    if (!filesystem::exists("/dev/full")) {
+        return;
+    }
+    WriteAheadLog log("/dev/full", 0, 1);
+    const uint64_t lsn = log.Append(WalRecordType::REMOVE_DOCUMENT, "1234");
+    bool is_failed = false;
+    try {
+        log.WaitDurable(lsn);
+    } catch (const system_error&) {
+        is_failed = true;
+    }
+    CHECK(is_failed);
+
+    bool is_rejected = false;
+    try {
+        log.Append(WalRecordType::REMOVE_DOCUMENT, "5678");
+    } catch (const system_error&) {
+        is_rejected = true;
+    }
+    CHECK(is_rejected);
+}
+
+void RunTest(const filesystem::path& directory) {
+    const vector<Change> changes = MakeChanges();
+    TestCrashRecovery(directory, changes);
+    TestTruncatedTail(directory, changes);
+    TestStickyFailure();
+}
+
+} // namespace
+
+int main() {
+    const auto directory = MakeTemporaryDirectory("durable-recovery-test");
+    int result = 0;
+    try {
+        RunTest(directory);
+        cout << "durable_recovery_test: OK" << endl;
+    } catch (const exception& error) {
+        cerr << error.what() << endl;
+        result = 1;
+    }
+    filesystem::remove_all(directory);
+    return result;
+}
@@ -0,0 +1,80 @@
+#include "search_server.h"
+#include "test_utils.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// документы "aba".."abj" с id 1..10
+SearchServer MakeAlphabetServer() {
+    SearchServer search_server("and in with"s);
+    for (char c = 'a'; c <= 'j'; ++c) {
+        search_server.AddDocument(c - 'a' + 1, "ab"s + c, DocumentStatus::ACTUAL, {1});
+    }
+    return search_server;
+}
+
+// подготовленный запрос раскрывает префикс заново после смены ограничения
+void TestLimitChangeRefreshesPreparedQuery() {
+    SearchServer search_server = MakeAlphabetServer();
+    const PreparedQuery query = search_server.PrepareQuery("ab*");
+    CHECK(search_server.FindTopDocuments(query).size() == MAX_RESULT_DOCUMENT_COUNT);
+
+    search_server.SetPrefixExpansionLimit(2);
+    CHECK(search_server.FindTopDocuments("ab*").size() == 2);
+    CHECK(search_server.FindTopDocuments(query).size() == 2);
+}
+
+// минус-префикс исключает документы со всеми подходящими словами, а не с первыми limit
+void TestMinusPrefixIgnoresLimit() {
+    SearchServer search_server = MakeAlphabetServer();
+    search_server.SetPrefixExpansionLimit(2);
+    CHECK(search_server.FindTopDocuments("aba abj -ab*").empty());
+    CHECK(search_server.FindTopDocuments(search_server.PrepareQuery("aba abj -ab*")).empty());
+    CHECK(get<0>(search_server.MatchDocument("abj -ab*", 10)).empty());
+}
+
+// плюс-префикс раскрывается в слова из наибольшего числа документов, а не в первые по алфавиту
+void TestPlusPrefixKeepsFrequentWords() {
+    SearchServer search_server("and in with"s);
+    search_server.AddDocument(1, "aba", DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "abb", DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(3, "abz cat", DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(4, "abz dog", DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(5, "abz", DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(6, "aby cat", DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(7, "aby", DocumentStatus::ACTUAL, {1});
+    search_server.SetPrefixExpansionLimit(2);
+
+    vector<int> ids;
+    for (const Document& document : search_server.FindTopDocuments("ab*")) {
+        ids.push_back(document.id);
+    }
+    sort(ids.begin(), ids.end());
+    CHECK(ids == vector<int>({3, 4, 5, 6, 7}));
+
+    // при равной частоте - первые по алфавиту
+    search_server.SetPrefixExpansionLimit(3);
+    CHECK(search_server.FindTopDocuments("ab* -aby -abz").size() == 1);
+    CHECK(search_server.FindTopDocuments("ab* -aby -abz")[0].id == 1);
+}
+
+} // namespace
+
+int main() {
+    try {
+        TestLimitChangeRefreshesPreparedQuery();
+        TestMinusPrefixIgnoresLimit();
+        TestPlusPrefixKeepsFrequentWords();
+    } catch (const exception& error) {
+        cerr << error.what() << endl;
+        return 1;
+    }
+    cout << "prefix_query_test: OK" << endl;
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "search_server.h"
+#include "test_utils.h"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const string STOP_WORDS = "and in with";
+
+vector<int> GetIds(const vector<Document>& documents) {
+    vector<int> ids;
+    for (const Document& document : documents) {
+        ids.push_back(document.id);
+    }
+    return ids;
+}
+
+// запрос, подготовленный уничтоженным сервером, на сервере с той же версией индекса
+// сопоставляется заново, а не ходит по чужим спискам документов
+void TestQueryFromDestroyedServer() {
+    PreparedQuery query;
+    {
+        auto first = make_unique<SearchServer>(STOP_WORDS);
+        first->AddDocument(1, "white cat", DocumentStatus::ACTUAL, {1});
+        first->AddDocument(2, "black cat", DocumentStatus::ACTUAL, {2});
+        query = first->PrepareQuery("cat -dog");
+    }
+
+    SearchServer second(STOP_WORDS);
+    second.AddDocument(10, "big dog", DocumentStatus::ACTUAL, {1});
+    second.AddDocument(20, "fluffy cat", DocumentStatus::ACTUAL, {3});
+    CHECK(second.GetIndexVersion() == query.GetIndexVersion());
+
+    CHECK(GetIds(second.FindTopDocuments(query)) == vector<int>{20});
+    CHECK(GetIds(second.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL)) == vector<int>{20});
+    CHECK(get<0>(second.MatchDocument(query, 20)) == vector<string_view>{"cat"});
+    CHECK(get<0>(second.MatchDocument(query, 10)).empty());
+    const MatchedDocuments matched = second.MatchDocuments(query, {10, 20});
+    CHECK(matched.document_ids == vector<int>({10, 20}));
+    CHECK(matched.GetWords(0).size() == 0);
+    CHECK(matched.GetWords(1).size() == 1 && *matched.GetWords(1).begin() == "cat");
+
+    second.RefreshQuery(query);
+    CHECK(GetIds(second.FindTopDocuments(query)) == vector<int>{20});
+}
+
+// копия сервера с той же версией индекса не пользуется сопоставлением, сделанным оригиналом
+void TestQueryFromCopiedServer() {
+    SearchServer original(STOP_WORDS);
+    original.AddDocument(1, "white cat", DocumentStatus::ACTUAL, {1});
+    SearchServer copy = original;
+    original.AddDocument(2, "black cat", DocumentStatus::ACTUAL, {2});
+    copy.AddDocument(3, "grey cat", DocumentStatus::ACTUAL, {3});
+    PreparedQuery query = original.PrepareQuery("cat");
+    CHECK(copy.GetIndexVersion() == query.GetIndexVersion());
+
+    vector<int> ids = GetIds(copy.FindTopDocuments(query));
+    sort(ids.begin(), ids.end());
+    CHECK(ids == vector<int>({1, 3}));
+    CHECK(get<0>(copy.MatchDocument(query, 3)) == vector<string_view>{"cat"});
+}
+
+} // namespace
+
+int main() {
+    try {
+        TestQueryFromDestroyedServer();
+        TestQueryFromCopiedServer();
+    } catch (const exception& error) {
+        cerr << error.what() << endl;
+        return 1;
+    }
+    cout << "prepared_query_test: OK" << endl;
+    return 0;
+}
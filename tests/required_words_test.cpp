@@ -0,0 +1,175 @@
+#include "search_server.h"
+#include "test_utils.h"
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const string STOP_WORDS = "and in with";
+
+vector<int> GetSortedIds(const vector<Document>& documents) {
+    vector<int> ids;
+    for (const Document& document : documents) {
+        ids.push_back(document.id);
+    }
+    sort(ids.begin(), ids.end());
+    return ids;
+}
+
+SearchServer MakePetServer() {
+    SearchServer search_server(STOP_WORDS);
+    search_server.AddDocument(1, "white cat", DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "black cat and dog", DocumentStatus::ACTUAL, {2});
+    search_server.AddDocument(3, "dog with collar", DocumentStatus::ACTUAL, {3});
+    search_server.AddDocument(4, "fluffy cat with dots", DocumentStatus::ACTUAL, {4});
+    search_server.AddDocument(5, "white dog", DocumentStatus::ACTUAL, {5});
+    return search_server;
+}
+
+// +слово оставляет документы с ним, релевантность та же, что без +
+void TestRequiredWordFiltersDocuments() {
+    const SearchServer search_server = MakePetServer();
+    CHECK(GetSortedIds(search_server.FindTopDocuments("+cat dog")) == vector<int>({1, 2, 4}));
+    CHECK(GetSortedIds(search_server.FindTopDocuments(execution::par, "+cat dog")) == vector<int>({1, 2, 4}));
+    CHECK(GetSortedIds(search_server.FindTopDocuments("+cat +dog")) == vector<int>({2}));
+
+    const auto with_plus = search_server.FindTopDocuments("+cat dog");
+    const auto without_plus = search_server.FindTopDocuments("cat dog");
+    for (const Document& document : with_plus) {
+        const auto it = find_if(without_plus.begin(), without_plus.end(), [&document](const Document& other) {
+            return other.id == document.id;
+        });
+        CHECK(it != without_plus.end() && it->relevance == document.relevance);
+    }
+}
+
+// обязательного слова нет в словаре - не подходит ни один документ
+void TestUnknownRequiredWord() {
+    const SearchServer search_server = MakePetServer();
+    CHECK(search_server.FindTopDocuments("+parrot cat").empty());
+    CHECK(search_server.FindTopDocuments(execution::par, "+parrot cat").empty());
+    CHECK(search_server.FindTopDocuments(search_server.PrepareQuery("+parrot cat")).empty());
+    CHECK(get<0>(search_server.MatchDocument("+parrot cat", 1)).empty());
+    CHECK(get<0>(search_server.MatchDocument(execution::par, "+parrot cat", 1)).empty());
+    const MatchedDocuments matched = search_server.MatchDocuments("+parrot cat", {1, 2});
+    CHECK(matched.words.empty());
+}
+
+void TestRequiredAndMinusWords() {
+    const SearchServer search_server = MakePetServer();
+    CHECK(GetSortedIds(search_server.FindTopDocuments("+cat -white")) == vector<int>({2, 4}));
+    CHECK(GetSortedIds(search_server.FindTopDocuments("+cat dog -black")) == vector<int>({1, 4}));
+    CHECK(search_server.FindTopDocuments("+cat -cat").empty());
+    CHECK(get<0>(search_server.MatchDocument("+cat -white", 1)).empty());
+    CHECK(get<0>(search_server.MatchDocument("+cat -white", 2)) == vector<string_view>{"cat"});
+}
+
+// префикс добавляет релевантность, но не ослабляет обязательное слово
+void TestRequiredWordAndPrefix() {
+    const SearchServer search_server = MakePetServer();
+    CHECK(GetSortedIds(search_server.FindTopDocuments("+cat do*")) == vector<int>({1, 2, 4}));
+    CHECK(GetSortedIds(search_server.FindTopDocuments("+dog -do*")).empty());
+    CHECK(GetSortedIds(search_server.FindTopDocuments("+dog -col*")) == vector<int>({2, 5}));
+    const auto [words, status] = search_server.MatchDocument("+cat do*", 4);
+    CHECK(words == vector<string_view>({"cat", "dots"}));
+    CHECK(get<0>(search_server.MatchDocument("+cat do*", 3)).empty());
+}
+
+// MatchDocument(s) не возвращает слов документа без обязательного слова
+void TestMatchHonoursRequiredWords() {
+    const SearchServer search_server = MakePetServer();
+    for (const int id : {1, 3, 4, 5}) {
+        CHECK(get<0>(search_server.MatchDocument("+dog +cat white", id)).empty());
+        CHECK(get<0>(search_server.MatchDocument(execution::par, "+dog +cat white", id)).empty());
+    }
+    CHECK(get<0>(search_server.MatchDocument("+dog +cat white", 2)) == vector<string_view>({"cat", "dog"}));
+    CHECK(get<0>(search_server.MatchDocument(search_server.PrepareQuery("+cat white"), 5)).empty());
+
+    const MatchedDocuments matched = search_server.MatchDocuments("+cat white", {1, 2, 3, 4, 5});
+    CHECK(matched.size() == 5);
+    const vector<size_t> expected_counts = {2, 1, 0, 1, 0};
+    for (size_t i = 0; i < matched.size(); ++i) {
+        CHECK(matched.GetWords(i).size() == expected_counts[i]);
+    }
+}
+
+void TestRequiredWordSyntax() {
+    const SearchServer search_server = MakePetServer();
+    // обязательное стоп-слово, как и обычное, не учитывается
+    CHECK(GetSortedIds(search_server.FindTopDocuments("+and cat")) == vector<int>({1, 2, 4}));
+    for (const string query : {"+", "++cat", "+-cat", "-+cat", "+cat*"}) {
+        bool is_rejected = false;
+        try {
+            search_server.FindTopDocuments(query);
+        } catch (const invalid_argument&) {
+            is_rejected = true;
+        }
+        CHECK(is_rejected);
+    }
+}
+
+// пересечение длинных и коротких списков против фильтра по тем же словам
+void TestIntersectionMatchesFilter() {
+    SearchServer search_server(STOP_WORDS);
+    vector<set<string>> document_words;
+    mt19937 generator(41);
+    for (int id = 0; id < 2000; ++id) {
+        set<string> words;
+        string text;
+        const size_t word_count = 2 + generator() % 15;
+        for (size_t i = 0; i < word_count; ++i) {
+            const double x = uniform_real_distribution<double>(0.0, 1.0)(generator);
+            const string word = "w" + to_string(static_cast<int>(x * x * 80));
+            words.insert(word);
+            text += (i > 0 ? " " : "") + word;
+        }
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {static_cast<int>(generator() % 10)});
+        document_words.push_back(move(words));
+    }
+
+    for (int i = 0; i < 200; ++i) {
+        const string first = "w" + to_string(generator() % 10);
+        const string second = "w" + to_string(generator() % 80);
+        const string other = "w" + to_string(generator() % 40);
+        const auto has_required = [&](int document_id, DocumentStatus, int) {
+            const set<string>& words = document_words[document_id];
+            return words.count(first) > 0 && words.count(second) > 0;
+        };
+        const auto expected = search_server.FindTopDocuments(first + " " + second + " " + other, has_required);
+        for (const auto& actual : {search_server.FindTopDocuments("+" + first + " +" + second + " " + other),
+                                   search_server.FindTopDocuments(execution::par, "+" + first + " +" + second + " " + other)}) {
+            CHECK(expected.size() == actual.size());
+            for (size_t j = 0; j < expected.size(); ++j) {
+                CHECK(expected[j].id == actual[j].id);
+                CHECK(expected[j].relevance == actual[j].relevance);
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    try {
+        TestRequiredWordFiltersDocuments();
+        TestUnknownRequiredWord();
+        TestRequiredAndMinusWords();
+        TestRequiredWordAndPrefix();
+        TestMatchHonoursRequiredWords();
+        TestRequiredWordSyntax();
+        TestIntersectionMatchesFilter();
+    } catch (const exception& error) {
+        cerr << error.what() << endl;
+        return 1;
+    }
+    cout << "required_words_test: OK" << endl;
+    return 0;
+}
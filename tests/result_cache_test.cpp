@@ -0,0 +1,144 @@
+#include "search_server.h"
+#include "test_utils.h"
+
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const string STOP_WORDS = "and in with";
+const int INITIAL_DOCUMENT_COUNT = 800;
+const int ROUND_COUNT = 25;
+
+// сервер с кэшем и сервер без него получают одни и те же изменения
+class CachedAndPlainServers {
+public:
+    explicit CachedAndPlainServers(const ResultCacheOptions& options)
+        : cached_(STOP_WORDS)
+        , plain_(STOP_WORDS) {
+        cached_.EnableResultCache(options);
+    }
+
+    void AddDocument(int document_id, const string& text, DocumentStatus status, const vector<int>& ratings) {
+        cached_.AddDocument(document_id, text, status, ratings);
+        plain_.AddDocument(document_id, text, status, ratings);
+        ids_.insert(document_id);
+    }
+
+    void RemoveDocument(int document_id) {
+        cached_.RemoveDocument(document_id);
+        plain_.RemoveDocument(document_id);
+        ids_.erase(document_id);
+    }
+
+    void CheckQuery(const string& query, DocumentStatus status) const {
+        const vector<Document> expected = plain_.FindTopDocuments(query, status);
+        const vector<Document> actual = cached_.FindTopDocuments(query, status);
+        CHECK(expected.size() == actual.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            CHECK(expected[i].id == actual[i].id);
+            CHECK(expected[i].rating == actual[i].rating);
+            CHECK(expected[i].relevance == actual[i].relevance);
+        }
+    }
+
+    const set<int>& GetIds() const {
+        return ids_;
+    }
+
+    ResultCacheStats GetStats() const {
+        return cached_.GetResultCacheStats();
+    }
+
+private:
+    SearchServer cached_;
+    SearchServer plain_;
+    set<int> ids_;
+};
+
+string MakeText(mt19937& generator) {
+    // частые слова в начале словаря, чтобы у запросов были длинные списки документов
+    string text;
+    const size_t word_count = 3 + generator() % 12;
+    for (size_t i = 0; i < word_count; ++i) {
+        const double x = uniform_real_distribution<double>(0.0, 1.0)(generator);
+        text += (i > 0 ? " " : "") + "w"s + to_string(static_cast<int>(x * x * 60));
+    }
+    return text;
+}
+
+// запросы из одного-двух слов попадают в кэш; с минус-словами и статусом BANNED - нет
+void RunChurn(const ResultCacheOptions& options, size_t max_entries) {
+    CachedAndPlainServers servers(options);
+    mt19937 generator(23);
+    const auto random_status = [&generator] {
+        return generator() % 10 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+    };
+    for (int id = 0; id < INITIAL_DOCUMENT_COUNT; ++id) {
+        servers.AddDocument(id, MakeText(generator), random_status(), {static_cast<int>(generator() % 10)});
+    }
+
+    vector<string> queries;
+    for (int i = 0; i < 40; ++i) {
+        queries.push_back("w" + to_string(i % 20));
+        queries.push_back("w" + to_string(i % 15) + " w" + to_string(20 + i));
+    }
+    queries.push_back("w1 -w2");
+    queries.push_back("w3*");
+
+    int next_id = INITIAL_DOCUMENT_COUNT;
+    vector<int> removed_ids;
+    for (int round = 0; round < ROUND_COUNT; ++round) {
+        for (int repeat = 0; repeat < 3; ++repeat) {
+            for (const string& query : queries) {
+                servers.CheckQuery(query, DocumentStatus::ACTUAL);
+            }
+        }
+        servers.CheckQuery(queries[round % queries.size()], DocumentStatus::BANNED);
+
+        // новые документы, удаление случайных и возврат части удалённых
+        for (int i = 0; i < 30; ++i) {
+            servers.AddDocument(next_id++, MakeText(generator), random_status(), {static_cast<int>(generator() % 10)});
+        }
+        for (int i = 0; i < 40; ++i) {
+            const auto& ids = servers.GetIds();
+            const int id = *next(ids.begin(), generator() % ids.size());
+            servers.RemoveDocument(id);
+            removed_ids.push_back(id);
+        }
+        for (int i = 0; i < 5 && !removed_ids.empty(); ++i) {
+            servers.AddDocument(removed_ids.back(), MakeText(generator), DocumentStatus::ACTUAL, {9});
+            removed_ids.pop_back();
+        }
+    }
+
+    const ResultCacheStats stats = servers.GetStats();
+    CHECK(stats.hits > 0);
+    CHECK(stats.builds > 0);
+    CHECK(stats.entries > 0 && stats.entries <= max_entries);
+}
+
+} // namespace
+
+int main() {
+    try {
+        // одна часть кэша, маленькая запись и вытеснение: частые перестроения
+        ResultCacheOptions small;
+        small.max_entries = 8;
+        small.min_query_count = 2;
+        small.candidate_count = 12;
+        RunChurn(small, small.max_entries);
+        // настройки по умолчанию: несколько частей
+        RunChurn({}, ResultCacheOptions{}.max_entries);
+    } catch (const exception& error) {
+        cerr << error.what() << endl;
+        return 1;
+    }
+    cout << "result_cache_test: OK" << endl;
+    return 0;
+}
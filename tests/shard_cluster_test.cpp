@@ -0,0 +1,170 @@
+#include "search_server.h"
+#include "shard_aggregator.h"
+#include "shard_protocol.h"
+#include "test_utils.h"
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const size_t SHARD_COUNT = 3;
+const int DOCUMENT_COUNT = 600;
+const int QUERY_COUNT = 500;
+const string STOP_WORDS = "and in with";
+
+// процессы search_shard_server, завершаемые в деструкторе
+class ShardProcesses {
+public:
+    ShardProcesses(const string& server_path, const vector<string>& addresses) {
+        for (const string& address : addresses) {
+            const pid_t pid = fork();
+            CHECK(pid >= 0);
+            if (pid == 0) {
+                execl(server_path.c_str(), server_path.c_str(), address.c_str(), STOP_WORDS.c_str(), nullptr);
+                _exit(127);
+            }
+            pids_.push_back(pid);
+        }
+        try {
+            for (const string& address : addresses) {
+                WaitUntilListening(address);
+            }
+        } catch (...) {
+            Stop();
+            throw;
+        }
+    }
+
+    ~ShardProcesses() {
+        Stop();
+    }
+
+private:
+    void Stop() {
+        for (const pid_t pid : pids_) {
+            kill(pid, SIGTERM);
+            waitpid(pid, nullptr, 0);
+        }
+        pids_.clear();
+    }
+
+    static void WaitUntilListening(const string& address) {
+        const auto deadline = chrono::steady_clock::now() + 10s;
+        while (true) {
+            try {
+                close(ConnectToAddress(address));
+                return;
+            } catch (const exception&) {
+                CHECK(chrono::steady_clock::now() < deadline);
+                this_thread::sleep_for(10ms);
+            }
+        }
+    }
+
+    vector<pid_t> pids_;
+};
+
+string MakeText(mt19937& generator, size_t word_count, const vector<string>& vocabulary) {
+    // частые слова в начале словаря: квадрат равномерного распределения
+    uniform_real_distribution<double> distribution(0.0, 1.0);
+    string text;
+    for (size_t i = 0; i < word_count; ++i) {
+        const double x = distribution(generator);
+        text += (i > 0 ? " " : "") + vocabulary[static_cast<size_t>(x * x * vocabulary.size())];
+    }
+    return text;
+}
+
+void CheckSameDocuments(const vector<Document>& expected, const vector<Document>& actual) {
+    CHECK(expected.size() == actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        CHECK(expected[i].id == actual[i].id);
+        CHECK(expected[i].rating == actual[i].rating);
+        CHECK(abs(expected[i].relevance - actual[i].relevance) < EPSILON);
+    }
+}
+
+void RunTest(const string& server_path, const filesystem::path& directory) {
+    vector<string> addresses;
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        addresses.push_back("unix:" + (directory / ("shard" + to_string(i) + ".sock")).string());
+    }
+
+    vector<string> vocabulary;
+    for (int i = 0; i < 150; ++i) {
+        vocabulary.push_back("w" + to_string(i));
+    }
+    vocabulary.push_back("and");
+    vocabulary.push_back("in");
+
+    ShardProcesses shards(server_path, addresses);
+    ShardAggregator aggregator(addresses, 5s);
+    SearchServer search_server(STOP_WORDS);
+
+    mt19937 generator(17);
+    for (int id = 0; id < DOCUMENT_COUNT; ++id) {
+        const string text = MakeText(generator, 5 + generator() % 20, vocabulary);
+        const auto status = id % 7 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        const vector<int> ratings = {static_cast<int>(generator() % 11) - 5, static_cast<int>(generator() % 11)};
+        aggregator.AddDocument(id, text, status, ratings);
+        search_server.AddDocument(id, text, status, ratings);
+    }
+
+    for (int i = 0; i < QUERY_COUNT; ++i) {
+        string query = MakeText(generator, 1 + generator() % 4, vocabulary);
+        if (i % 3 == 0) {
+            query += " -" + vocabulary[generator() % 20];
+        }
+        if (i % 5 == 0) {
+            query += " +" + vocabulary[generator() % 10];
+        }
+        const auto status = i % 4 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        const ShardedSearchResult result = aggregator.FindTopDocuments(query, status);
+        CHECK(result.failed_shards.empty());
+        CheckSameDocuments(search_server.FindTopDocuments(query, status), result.documents);
+    }
+
+    // некорректный запрос - ошибка запроса, а не отказ шардов
+    bool is_rejected = false;
+    try {
+        aggregator.FindTopDocuments("w1 --w2");
+    } catch (const invalid_argument&) {
+        is_rejected = true;
+    }
+    CHECK(is_rejected);
+}
+
+} // namespace
+
+// shard_cluster_test <путь к search_shard_server>
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        cerr << "Usage: " << argv[0] << " <search_shard_server>" << endl;
+        return 2;
+    }
+    const auto directory = MakeTemporaryDirectory("shard-cluster-test");
+    int result = 0;
+    try {
+        RunTest(argv[1], directory);
+        cout << "shard_cluster_test: OK" << endl;
+    } catch (const exception& error) {
+        cerr << error.what() << endl;
+        result = 1;
+    }
+    filesystem::remove_all(directory);
+    return result;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+// тесты - отдельные программы; неудачная проверка бросает TestFailure, main ловит его,
+// и деструкторы успевают остановить процессы и удалить файлы теста
+class TestFailure : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if (!(condition)) {                                                                \
+            throw TestFailure(std::string(__FILE__) + ":" + std::to_string(__LINE__)       \
+                              + ": check failed: " #condition);                            \
+        }                                                                                  \
+    } while (false)
+
+// новый пустой каталог во временном каталоге системы
+inline std::filesystem::path MakeTemporaryDirectory(const std::string& name) {
+    std::random_device random;
+    const std::filesystem::path path = std::filesystem::temp_directory_path()
+        / (name + "-" + std::to_string(random()));
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    return path;
+}